@@ -1,3 +1,5 @@
+#pragma once
+
 typedef enum OPTION {
     OPTION_NONE,
     OPTION_ERROR,
@@ -0,0 +1,278 @@
+/**
+ * Server configuration file, one "key = value" per line and '#' comments
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "../http/http.h"
+
+#define CONFIG_MAX_FILE_LEN (1 << 20)
+
+static bool isSpace(const char c) {
+    return (c == ' ' || c == '\t' || c == '\r');
+}
+
+static CharSlice trim(CharSlice slice) {
+    while (slice.len > 0 && isSpace(slice.ptr[0])) {
+        slice.ptr += 1;
+        slice.len -= 1;
+    }
+    while (slice.len > 0 && isSpace(slice.ptr[slice.len - 1])) {
+        slice.len -= 1;
+    }
+    return slice;
+}
+
+static bool sliceEqual(CharSlice slice, const char *str) {
+    return slice.len == strlen(str) && strncmp(slice.ptr, str, slice.len) == 0;
+}
+
+static bool parseNumber(CharSlice value, long min, long max, long *number) {
+    if (value.len == 0) {
+        return false;
+    }
+    long result = 0;
+    for (size_t i = 0; i < value.len; i++) {
+        if (value.ptr[i] < '0' || value.ptr[i] > '9') {
+            return false;
+        }
+        result = result * 10 + (value.ptr[i] - '0');
+        if (result > max) {
+            return false;
+        }
+    }
+    if (result < min) {
+        return false;
+    }
+    *number = result;
+    return true;
+}
+
+// "port", "ipv4:port" or "[ipv6]:port"
+static bool parseListen(CharSlice value, ListenAddress *listen) {
+    char host[INET6_ADDRSTRLEN] = "0.0.0.0";
+    CharSlice port_digits = value;
+    bool ipv6 = false;
+
+    if (value.len > 0 && value.ptr[0] == '[') {
+        char * end = memchr(value.ptr, ']', value.len);
+        if (end == NULL || end + 1 == value.ptr + value.len || end[1] != ':') {
+            return false;
+        }
+        size_t host_len = end - value.ptr - 1;
+        if (host_len >= sizeof(host)) {
+            return false;
+        }
+        memcpy(host, value.ptr + 1, host_len);
+        host[host_len] = '\0';
+        port_digits.ptr = end + 2;
+        port_digits.len = value.len - (host_len + 3);
+        ipv6 = true;
+    } else {
+        char * colon = memchr(value.ptr, ':', value.len);
+        if (colon != NULL) {
+            size_t host_len = colon - value.ptr;
+            if (host_len >= sizeof(host)) {
+                return false;
+            }
+            memcpy(host, value.ptr, host_len);
+            host[host_len] = '\0';
+            port_digits.ptr = colon + 1;
+            port_digits.len = value.len - host_len - 1;
+        }
+    }
+
+    long port = 0;
+    if (!parseNumber(port_digits, 1, UINT16_MAX, &port)) {
+        return false;
+    }
+
+    memset(listen, 0, sizeof(*listen));
+    if (ipv6) {
+        struct sockaddr_in6 *addr = (struct sockaddr_in6 *)&listen->addr;
+        addr->sin6_family = AF_INET6;
+        addr->sin6_port = htons(port);
+        if (inet_pton(AF_INET6, host, &addr->sin6_addr) != 1) {
+            return false;
+        }
+        listen->addr_len = sizeof(*addr);
+    } else {
+        struct sockaddr_in *addr = (struct sockaddr_in *)&listen->addr;
+        addr->sin_family = AF_INET;
+        addr->sin_port = htons(port);
+        if (inet_pton(AF_INET, host, &addr->sin_addr) != 1) {
+            return false;
+        }
+        listen->addr_len = sizeof(*addr);
+    }
+    return true;
+}
+
+bool sameListenAddress(const ListenAddress *a, const ListenAddress *b) {
+    return a->addr_len == b->addr_len && memcmp(&a->addr, &b->addr, a->addr_len) == 0;
+}
+
+Config defaultConfig(void) {
+    Config config = {
+        .listen_count = 1,
+        .backlog = CONFIG_DEFAULT_BACKLOG,
+        .workers = 1,
+        .buffer_len = CONFIG_DEFAULT_BUFFER_LEN,
+        .read_timeout = CONFIG_DEFAULT_TIMEOUT,
+        .write_timeout = CONFIG_DEFAULT_TIMEOUT,
+        .file_cache_entries = FILE_CACHE_LEN,
+        .file_cache_ttl = FILE_CACHE_TTL,
+        .root_count = 1,
+        .roots = { CONFIG_DEFAULT_ROOT },
+    };
+
+    struct sockaddr_in *addr = (struct sockaddr_in *)&config.listen[0].addr;
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(CONFIG_DEFAULT_PORT);
+    addr->sin_addr.s_addr = htonl(INADDR_ANY);
+    config.listen[0].addr_len = sizeof(*addr);
+
+    return config;
+}
+
+ConfigOrErr parseConfig(char *source, size_t len) {
+    Config config = defaultConfig();
+    // The first listen / document_root line replaces the default instead of adding to it
+    bool listen_set = false;
+    bool root_set = false;
+
+    CharSlice remaining = { .ptr = source, .len = len };
+    size_t line_number = 0;
+
+    while (remaining.len > 0) {
+        line_number += 1;
+        char * newline = memchr(remaining.ptr, '\n', remaining.len);
+        size_t line_len = (newline == NULL) ? remaining.len : (size_t)(newline - remaining.ptr);
+        CharSlice line = { .ptr = remaining.ptr, .len = line_len };
+        remaining.ptr += (newline == NULL) ? line_len : line_len + 1;
+        remaining.len -= (newline == NULL) ? line_len : line_len + 1;
+
+        char * comment = memchr(line.ptr, '#', line.len);
+        if (comment != NULL) {
+            line.len = comment - line.ptr;
+        }
+        line = trim(line);
+        if (line.len == 0) {
+            continue;
+        }
+
+        char * equals = memchr(line.ptr, '=', line.len);
+        if (equals == NULL) {
+            ConfigOrErr error = AS_ERROR({ .error = CONFIG_ERROR_SYNTAX, .line = line_number });
+            return error;
+        }
+        CharSlice key = trim((CharSlice){ .ptr = line.ptr, .len = equals - line.ptr });
+        CharSlice value = trim((CharSlice){ .ptr = equals + 1, .len = line.len - (equals - line.ptr) - 1 });
+
+        long number = 0;
+        bool valid = true;
+
+        if (sliceEqual(key, "listen")) {
+            if (!listen_set) {
+                config.listen_count = 0;
+                listen_set = true;
+            }
+            if (config.listen_count == CONFIG_MAX_LISTEN) {
+                ConfigOrErr error = AS_ERROR({ .error = CONFIG_ERROR_TOO_MANY, .line = line_number });
+                return error;
+            }
+            valid = parseListen(value, &config.listen[config.listen_count]);
+            // The second bind would fail with EADDRINUSE anyway
+            for (size_t i = 0; valid && i < config.listen_count; i++) {
+                valid = !sameListenAddress(&config.listen[i], &config.listen[config.listen_count]);
+            }
+            config.listen_count += valid ? 1 : 0;
+        } else if (sliceEqual(key, "document_root")) {
+            if (!root_set) {
+                config.root_count = 0;
+                root_set = true;
+            }
+            if (config.root_count == CONFIG_MAX_ROOTS) {
+                ConfigOrErr error = AS_ERROR({ .error = CONFIG_ERROR_TOO_MANY, .line = line_number });
+                return error;
+            }
+            valid = value.len > 0 && value.len < CONFIG_PATH_LEN && memchr(value.ptr, '\0', value.len) == NULL;
+            if (valid) {
+                memcpy(config.roots[config.root_count], value.ptr, value.len);
+                config.roots[config.root_count][value.len] = '\0';
+                config.root_count += 1;
+            }
+        } else if (sliceEqual(key, "backlog")) {
+            valid = parseNumber(value, 1, 65535, &number);
+            config.backlog = (int)number;
+        } else if (sliceEqual(key, "workers")) {
+            valid = parseNumber(value, 1, CONFIG_MAX_WORKERS, &number);
+            config.workers = (size_t)number;
+        } else if (sliceEqual(key, "buffer_len")) {
+            valid = parseNumber(value, 256, 1 << 24, &number);
+            config.buffer_len = (size_t)number;
+        } else if (sliceEqual(key, "read_timeout")) {
+            valid = parseNumber(value, 0, 3600, &number);
+            config.read_timeout = (int)number;
+        } else if (sliceEqual(key, "write_timeout")) {
+            valid = parseNumber(value, 0, 3600, &number);
+            config.write_timeout = (int)number;
+        } else if (sliceEqual(key, "file_cache_entries")) {
+            valid = parseNumber(value, 1, FILE_CACHE_MAX_LEN, &number);
+            config.file_cache_entries = (size_t)number;
+        } else if (sliceEqual(key, "file_cache_ttl")) {
+            valid = parseNumber(value, 0, 86400, &number);
+            config.file_cache_ttl = (time_t)number;
+        } else {
+            ConfigOrErr error = AS_ERROR({ .error = CONFIG_ERROR_UNKNOWN_KEY, .line = line_number });
+            return error;
+        }
+
+        if (!valid) {
+            ConfigOrErr error = AS_ERROR({ .error = CONFIG_ERROR_BAD_VALUE, .line = line_number });
+            return error;
+        }
+    }
+
+    ConfigOrErr config_val = AS_VALUE(config);
+    return config_val;
+}
+
+ConfigOrErr loadConfig(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ConfigOrErr error = AS_ERROR({ .error = CONFIG_ERROR_IO, .line = 0 });
+        return error;
+    }
+
+    char *source = malloc(CONFIG_MAX_FILE_LEN);
+    size_t len = (source == NULL) ? 0 : fread(source, 1, CONFIG_MAX_FILE_LEN, file);
+    bool failed = source == NULL || ferror(file) || !feof(file);
+    fclose(file);
+
+    if (failed) {
+        free(source);
+        ConfigOrErr error = AS_ERROR({ .error = CONFIG_ERROR_IO, .line = 0 });
+        return error;
+    }
+
+    ConfigOrErr config_err = parseConfig(source, len);
+    free(source);
+    return config_err;
+}
+
+const char *configErrorName(CONFIG_ERROR error) {
+    switch (error) {
+        case CONFIG_ERROR_IO: return "cannot read file";
+        case CONFIG_ERROR_SYNTAX: return "expected key = value";
+        case CONFIG_ERROR_UNKNOWN_KEY: return "unknown key";
+        case CONFIG_ERROR_BAD_VALUE: return "bad value";
+        case CONFIG_ERROR_TOO_MANY: return "too many entries";
+    }
+    return "unknown error";
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include "../common/types.h"
+
+#define CONFIG_DEFAULT_PORT 42069
+#define CONFIG_DEFAULT_BACKLOG 128
+#define CONFIG_DEFAULT_BUFFER_LEN 1024
+// Seconds, a worker stuck on a silent client holds back the reclaim of retired snapshots
+#define CONFIG_DEFAULT_TIMEOUT 30
+#define CONFIG_DEFAULT_ROOT "."
+
+#define CONFIG_MAX_LISTEN 8
+#define CONFIG_MAX_ROOTS 8
+#define CONFIG_MAX_WORKERS 64
+#define CONFIG_PATH_LEN 256
+
+typedef enum CONFIG_ERROR {
+    CONFIG_ERROR_IO,
+    CONFIG_ERROR_SYNTAX,
+    CONFIG_ERROR_UNKNOWN_KEY,
+    CONFIG_ERROR_BAD_VALUE,
+    CONFIG_ERROR_TOO_MANY,
+} CONFIG_ERROR;
+
+typedef struct ConfigError {
+    CONFIG_ERROR error;
+    size_t line;
+} ConfigError;
+
+typedef struct ListenAddress {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+} ListenAddress;
+
+typedef struct Config {
+    size_t listen_count;
+    ListenAddress listen[CONFIG_MAX_LISTEN];
+    int backlog;
+    size_t workers;
+    size_t buffer_len;
+    // Seconds, 0 waits forever
+    int read_timeout;
+    int write_timeout;
+    size_t file_cache_entries;
+    time_t file_cache_ttl;
+    size_t root_count;
+    char roots[CONFIG_MAX_ROOTS][CONFIG_PATH_LEN];
+} Config;
+
+typedef AS_ERROR_TYPE(ConfigError, Config) ConfigOrErr;
+
+Config defaultConfig(void);
+ConfigOrErr parseConfig(char * source, size_t len);
+ConfigOrErr loadConfig(const char * path);
+
+bool sameListenAddress(const ListenAddress * a, const ListenAddress * b);
+const char * configErrorName(CONFIG_ERROR error);
@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "config.h"
+#include "../http/http.h"
+
+#define TEST(NAME) static void NAME(void **state)
+
+Config tryParseConfig(char * source) {
+    ConfigOrErr config_err = parseConfig(source, strlen(source));
+    assert_int_equal(OPTION_SOME, config_err.option);
+    return config_err.value;
+}
+
+void expectConfigError(char * source, CONFIG_ERROR error, size_t line) {
+    ConfigOrErr config_err = parseConfig(source, strlen(source));
+    assert_int_equal(OPTION_ERROR, config_err.option);
+    assert_int_equal(error, config_err.error.error);
+    assert_int_equal(line, config_err.error.line);
+}
+
+TEST(defaults) {
+    (void) state;
+
+    Config config = tryParseConfig("# nothing but a comment\n\n");
+
+    assert_int_equal(1, config.listen_count);
+    const struct sockaddr_in *addr = (const struct sockaddr_in *)&config.listen[0].addr;
+    assert_int_equal(AF_INET, addr->sin_family);
+    assert_int_equal(CONFIG_DEFAULT_PORT, ntohs(addr->sin_port));
+    assert_int_equal(CONFIG_DEFAULT_BACKLOG, config.backlog);
+    assert_int_equal(1, config.workers);
+    assert_int_equal(CONFIG_DEFAULT_BUFFER_LEN, config.buffer_len);
+    assert_int_equal(CONFIG_DEFAULT_TIMEOUT, config.read_timeout);
+    assert_int_equal(CONFIG_DEFAULT_TIMEOUT, config.write_timeout);
+    assert_int_equal(FILE_CACHE_LEN, config.file_cache_entries);
+    assert_int_equal(FILE_CACHE_TTL, config.file_cache_ttl);
+    assert_int_equal(1, config.root_count);
+    assert_string_equal(CONFIG_DEFAULT_ROOT, config.roots[0]);
+}
+
+TEST(full) {
+    (void) state;
+
+    Config config = tryParseConfig(
+        "listen = 127.0.0.1:8080\n"
+        "listen = [::1]:8443   # loopback only\n"
+        "listen=9000\r\n"
+        "backlog = 1024\n"
+        "workers = 8\n"
+        "buffer_len = 8192\n"
+        "read_timeout = 5\n"
+        "write_timeout = 30\n"
+        "file_cache_entries = 4096\n"
+        "file_cache_ttl = 10\n"
+        "document_root = /srv/www\n"
+        "document_root = /srv/fallback"
+    );
+
+    assert_int_equal(3, config.listen_count);
+
+    const struct sockaddr_in *v4 = (const struct sockaddr_in *)&config.listen[0].addr;
+    assert_int_equal(AF_INET, v4->sin_family);
+    assert_int_equal(8080, ntohs(v4->sin_port));
+    assert_int_equal(htonl(INADDR_LOOPBACK), v4->sin_addr.s_addr);
+
+    const struct sockaddr_in6 *v6 = (const struct sockaddr_in6 *)&config.listen[1].addr;
+    assert_int_equal(AF_INET6, v6->sin6_family);
+    assert_int_equal(8443, ntohs(v6->sin6_port));
+    assert_true(IN6_IS_ADDR_LOOPBACK(&v6->sin6_addr));
+
+    const struct sockaddr_in *any = (const struct sockaddr_in *)&config.listen[2].addr;
+    assert_int_equal(9000, ntohs(any->sin_port));
+    assert_int_equal(htonl(INADDR_ANY), any->sin_addr.s_addr);
+
+    assert_int_equal(1024, config.backlog);
+    assert_int_equal(8, config.workers);
+    assert_int_equal(8192, config.buffer_len);
+    assert_int_equal(5, config.read_timeout);
+    assert_int_equal(30, config.write_timeout);
+    assert_int_equal(4096, config.file_cache_entries);
+    assert_int_equal(10, config.file_cache_ttl);
+    assert_int_equal(2, config.root_count);
+    assert_string_equal("/srv/www", config.roots[0]);
+    assert_string_equal("/srv/fallback", config.roots[1]);
+}
+
+TEST(sameListen) {
+    (void) state;
+
+    Config a = tryParseConfig("listen = 0.0.0.0:80\nlisten = [::]:80\n");
+    Config b = tryParseConfig("listen = [::]:80\nlisten = 80\n");
+
+    assert_true(sameListenAddress(&a.listen[0], &b.listen[1]));
+    assert_true(sameListenAddress(&a.listen[1], &b.listen[0]));
+    assert_false(sameListenAddress(&a.listen[0], &a.listen[1]));
+}
+
+TEST(errors) {
+    (void) state;
+
+    expectConfigError("workers = 2\nworkers\n", CONFIG_ERROR_SYNTAX, 2);
+    expectConfigError("\n\nport = 80\n", CONFIG_ERROR_UNKNOWN_KEY, 3);
+    expectConfigError("workers = 0\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("workers = 1000\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("backlog = -1\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("buffer_len = 4k\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("listen = 0.0.0.0:70000\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("listen = localhost:80\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("listen = [::1\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("listen = [::1]\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("document_root =\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("file_cache_entries = 0\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("file_cache_entries = 65537\n", CONFIG_ERROR_BAD_VALUE, 1);
+    expectConfigError("listen = 127.0.0.1:80\nlisten = 127.0.0.1:80\n", CONFIG_ERROR_BAD_VALUE, 2);
+    expectConfigError("listen = 80\nlisten = 0.0.0.0:80\n", CONFIG_ERROR_BAD_VALUE, 2);
+    expectConfigError(
+        "listen = 1\nlisten = 2\nlisten = 3\nlisten = 4\nlisten = 5\n"
+        "listen = 6\nlisten = 7\nlisten = 8\nlisten = 9\n",
+        CONFIG_ERROR_TOO_MANY, 9);
+}
+
+int main(int argc, char *argv[]) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(defaults),
+        cmocka_unit_test(full),
+        cmocka_unit_test(sameListen),
+        cmocka_unit_test(errors),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
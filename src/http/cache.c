@@ -0,0 +1,93 @@
+/**
+ * Direct mapped cache of file metadata, lets revalidations skip stat()
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "http.h"
+
+static size_t hashPath(const char *path, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (const char *c = path; *c != '\0'; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619u;
+    }
+    return hash % len;
+}
+
+bool fileCacheInit(FileCache *cache, size_t len, time_t ttl) {
+    if (len == 0) {
+        len = FILE_CACHE_LEN;
+    }
+    if (len > FILE_CACHE_MAX_LEN) {
+        len = FILE_CACHE_MAX_LEN;
+    }
+
+    FileCacheEntry *entries = realloc(cache->entries, len * sizeof(*entries));
+    if (entries == NULL) {
+        return false;
+    }
+    memset(entries, 0, len * sizeof(*entries));
+
+    cache->entries = entries;
+    cache->len = len;
+    cache->ttl = ttl;
+    return true;
+}
+
+void fileCacheFree(FileCache *cache) {
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->len = 0;
+}
+
+FileMeta fileMetaFromStat(const struct stat *st) {
+    FileMeta meta = { .size = st->st_size, .mtime = st->st_mtime };
+    int etag_len = snprintf(meta.etag, HTTP_ETAG_LEN, "\"%llx-%llx\"",
+                            (unsigned long long)st->st_mtime, (unsigned long long)st->st_size);
+    meta.etag_len = (size_t)etag_len;
+    return meta;
+}
+
+void fileCacheStore(FileCache *cache, const char *path, const FileMeta *meta, time_t now) {
+    size_t path_len = strlen(path);
+    if (path_len >= FILE_CACHE_PATH_LEN || cache->len == 0) {
+        return;
+    }
+    FileCacheEntry *entry = &cache->entries[hashPath(path, cache->len)];
+    memcpy(entry->path, path, path_len + 1);
+    entry->checked_at = now;
+    entry->meta = *meta;
+}
+
+FileMetaOpt fileCacheLookup(FileCache *cache, const char *path, time_t now) {
+    size_t path_len = strlen(path);
+    FileCacheEntry *entry = NULL;
+
+    if (path_len < FILE_CACHE_PATH_LEN && cache->len > 0) {
+        entry = &cache->entries[hashPath(path, cache->len)];
+        if (now - entry->checked_at < cache->ttl && strcmp(entry->path, path) == 0) {
+            FileMetaOpt some = AS_SOME(entry->meta);
+            return some;
+        }
+    }
+
+    struct stat st;
+    if (stat(path, &st) == -1 || !S_ISREG(st.st_mode)) {
+        if (entry != NULL && strcmp(entry->path, path) == 0) {
+            entry->path[0] = '\0';
+        }
+        FileMetaOpt none = AS_NONE();
+        return none;
+    }
+
+    FileMeta meta = fileMetaFromStat(&st);
+    fileCacheStore(cache, path, &meta, now);
+
+    FileMetaOpt some = AS_SOME(meta);
+    return some;
+}
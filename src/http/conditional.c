@@ -0,0 +1,235 @@
+/**
+ * Conditional (RFC 9110 13) and range (RFC 9110 14) request evaluation
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "http.h"
+
+#define HTTP_DATE_FORMAT "%a, %d %b %Y %H:%M:%S GMT"
+
+TimeOpt parseHttpDate(CharSlice value) {
+    char buffer[64];
+    if (value.len >= sizeof(buffer)) {
+        TimeOpt none = AS_NONE();
+        return none;
+    }
+    memcpy(buffer, value.ptr, value.len);
+    buffer[value.len] = '\0';
+
+    struct tm tm = {0};
+    char * end = strptime(buffer, HTTP_DATE_FORMAT, &tm);
+    if (end == NULL || *end != '\0') {
+        TimeOpt none = AS_NONE();
+        return none;
+    }
+    TimeOpt some = AS_SOME(timegm(&tm));
+    return some;
+}
+
+size_t formatHttpDate(time_t time, char *buffer, size_t len) {
+    struct tm tm;
+    if (gmtime_r(&time, &tm) == NULL) {
+        return 0;
+    }
+    return strftime(buffer, len, HTTP_DATE_FORMAT, &tm);
+}
+
+static CharSlice trimList(CharSlice slice) {
+    while (slice.len > 0 && (slice.ptr[0] == ' ' || slice.ptr[0] == '\t')) {
+        slice.ptr += 1;
+        slice.len -= 1;
+    }
+    while (slice.len > 0 && (slice.ptr[slice.len - 1] == ' ' || slice.ptr[slice.len - 1] == '\t')) {
+        slice.len -= 1;
+    }
+    return slice;
+}
+
+// Pops the next comma separated list element off the front of list
+static bool nextElement(CharSlice *list, CharSlice *element) {
+    if (list->len == 0) {
+        return false;
+    }
+    char * comma = memchr(list->ptr, ',', list->len);
+    size_t len = (comma == NULL) ? list->len : (size_t)(comma - list->ptr);
+    *element = trimList((CharSlice){ .ptr = list->ptr, .len = len });
+    list->ptr += (comma == NULL) ? len : len + 1;
+    list->len -= (comma == NULL) ? len : len + 1;
+    return true;
+}
+
+static bool isWeakTag(CharSlice tag) {
+    return tag.len >= 2 && tag.ptr[0] == 'W' && tag.ptr[1] == '/';
+}
+
+static bool etagEqual(CharSlice tag, const FileMeta *meta, bool weak) {
+    if (isWeakTag(tag)) {
+        if (!weak) {
+            return false;
+        }
+        tag.ptr += 2;
+        tag.len -= 2;
+    }
+    return tag.len == meta->etag_len && memcmp(tag.ptr, meta->etag, tag.len) == 0;
+}
+
+static bool etagListMatches(CharSlice list, const FileMeta *meta) {
+    CharSlice tag;
+    while (nextElement(&list, &tag)) {
+        if ((tag.len == 1 && tag.ptr[0] == '*') || etagEqual(tag, meta, true)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isSafeMethod(const Request *request) {
+    return (request->method.len == 3 && strncmp(request->method.ptr, "GET", 3) == 0)
+        || (request->method.len == 4 && strncmp(request->method.ptr, "HEAD", 4) == 0);
+}
+
+bool isNotModified(const Request *request, const FileMeta *meta) {
+    if (!isSafeMethod(request)) {
+        return false;
+    }
+
+    StrOpt if_none_match = getHeader(request, "If-None-Match");
+    if (if_none_match.option == OPTION_SOME) {
+        return etagListMatches(if_none_match.some, meta);
+    }
+
+    StrOpt if_modified_since = getHeader(request, "If-Modified-Since");
+    if (if_modified_since.option == OPTION_SOME) {
+        TimeOpt since = parseHttpDate(if_modified_since.some);
+        return since.option == OPTION_SOME && meta->mtime <= since.some;
+    }
+
+    return false;
+}
+
+static bool parseOffset(CharSlice digits, off_t *offset) {
+    if (digits.len == 0) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < digits.len; i++) {
+        char c = digits.ptr[i];
+        if (c < '0' || c > '9' || value > (INT64_MAX - 9) / 10) {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    *offset = (off_t)value;
+    return true;
+}
+
+RANGE_RESULT parseRange(CharSlice value, off_t size, RangeSet *ranges) {
+    ranges->count = 0;
+
+    const size_t unit_len = strlen("bytes=");
+    if (value.len < unit_len || strncasecmp(value.ptr, "bytes=", unit_len) != 0) {
+        return RANGE_RESULT_NONE;
+    }
+    CharSlice list = { .ptr = value.ptr + unit_len, .len = value.len - unit_len };
+
+    size_t specs = 0;
+    CharSlice spec;
+    while (nextElement(&list, &spec)) {
+        if (spec.len == 0) {
+            continue;
+        }
+        // Too many ranges is treated as an abuse of the header and ignored
+        if (specs == HTTP_MAX_RANGES) {
+            ranges->count = 0;
+            return RANGE_RESULT_NONE;
+        }
+        specs += 1;
+
+        char * dash = memchr(spec.ptr, '-', spec.len);
+        if (dash == NULL) {
+            ranges->count = 0;
+            return RANGE_RESULT_NONE;
+        }
+        CharSlice first_digits = { .ptr = spec.ptr, .len = dash - spec.ptr };
+        CharSlice last_digits = { .ptr = dash + 1, .len = spec.len - first_digits.len - 1 };
+
+        off_t first = 0;
+        off_t last = 0;
+        if (first_digits.len == 0) {
+            off_t suffix = 0;
+            if (!parseOffset(last_digits, &suffix)) {
+                ranges->count = 0;
+                return RANGE_RESULT_NONE;
+            }
+            if (suffix == 0 || size == 0) {
+                continue;
+            }
+            first = (suffix < size) ? size - suffix : 0;
+            last = size - 1;
+        } else {
+            if (!parseOffset(first_digits, &first)) {
+                ranges->count = 0;
+                return RANGE_RESULT_NONE;
+            }
+            if (last_digits.len == 0) {
+                last = size - 1;
+            } else if (!parseOffset(last_digits, &last) || last < first) {
+                ranges->count = 0;
+                return RANGE_RESULT_NONE;
+            }
+            if (first >= size) {
+                continue;
+            }
+            if (last >= size) {
+                last = size - 1;
+            }
+        }
+
+        ByteRange range = { .first = first, .last = last };
+        ranges->ranges[ranges->count] = range;
+        ranges->count += 1;
+    }
+
+    if (specs == 0) {
+        return RANGE_RESULT_NONE;
+    }
+    return (ranges->count == 0) ? RANGE_RESULT_UNSATISFIABLE : RANGE_RESULT_SATISFIABLE;
+}
+
+RANGE_RESULT evaluateRange(const Request *request, const FileMeta *meta, RangeSet *ranges) {
+    ranges->count = 0;
+
+    if (request->method.len != 3 || strncmp(request->method.ptr, "GET", 3) != 0) {
+        return RANGE_RESULT_NONE;
+    }
+
+    StrOpt range = getHeader(request, "Range");
+    if (range.option != OPTION_SOME) {
+        return RANGE_RESULT_NONE;
+    }
+
+    // A stale If-Range means the client's partial copy is useless, send it all
+    StrOpt if_range = getHeader(request, "If-Range");
+    if (if_range.option == OPTION_SOME) {
+        CharSlice validator = if_range.some;
+        if (validator.len > 0 && (validator.ptr[0] == '"' || isWeakTag(validator))) {
+            if (!etagEqual(validator, meta, false)) {
+                return RANGE_RESULT_NONE;
+            }
+        } else {
+            TimeOpt date = parseHttpDate(validator);
+            if (date.option != OPTION_SOME || date.some != meta->mtime) {
+                return RANGE_RESULT_NONE;
+            }
+        }
+    }
+
+    return parseRange(range.some, meta->size, ranges);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "../common/types.h"
+#include "../uri/uri.h"
+
+#define HTTP_MAX_HEADERS 32
+#define HTTP_MAX_RANGES 8
+#define HTTP_ETAG_LEN 48
+
+// Default and largest FileCache.len, the entries are allocated when the cache is initialised
+#define FILE_CACHE_LEN 64
+#define FILE_CACHE_MAX_LEN (1 << 16)
+#define FILE_CACHE_PATH_LEN 256
+// Default seconds a cached stat() result is trusted before the file is looked at again
+#define FILE_CACHE_TTL 1
+
+typedef enum HTTP_ERROR {
+    HTTP_ERROR_BAD_REQUEST,
+    HTTP_ERROR_TOO_MANY_HEADERS,
+} HTTP_ERROR;
+
+typedef struct Header {
+    CharSlice name;
+    CharSlice value;
+} Header;
+
+typedef struct Request {
+    CharSlice method;
+    CharSlice target;
+    CharSlice version;
+    Uri uri;
+    size_t header_count;
+    Header headers[HTTP_MAX_HEADERS];
+} Request;
+
+typedef AS_ERROR_TYPE(HTTP_ERROR, Request) RequestOrErr;
+typedef AS_OPTION_TYPE(time_t) TimeOpt;
+
+RequestOrErr parseRequest(char * source, size_t len);
+StrOpt getHeader(const Request * request, const char * name);
+
+typedef struct FileMeta {
+    off_t size;
+    time_t mtime;
+    size_t etag_len;
+    char etag[HTTP_ETAG_LEN];
+} FileMeta;
+
+typedef AS_OPTION_TYPE(FileMeta) FileMetaOpt;
+
+typedef struct FileCacheEntry {
+    char path[FILE_CACHE_PATH_LEN];
+    time_t checked_at;
+    FileMeta meta;
+} FileCacheEntry;
+
+typedef struct FileCache {
+    size_t len;
+    time_t ttl;
+    FileCacheEntry * entries;
+} FileCache;
+
+// The cache must be zeroed or initialised before, existing entries are reallocated and cleared
+bool fileCacheInit(FileCache * cache, size_t len, time_t ttl);
+void fileCacheFree(FileCache * cache);
+FileMeta fileMetaFromStat(const struct stat * st);
+void fileCacheStore(FileCache * cache, const char * path, const FileMeta * meta, time_t now);
+FileMetaOpt fileCacheLookup(FileCache * cache, const char * path, time_t now);
+
+typedef struct ByteRange {
+    off_t first;
+    off_t last;
+} ByteRange;
+
+typedef struct RangeSet {
+    size_t count;
+    ByteRange ranges[HTTP_MAX_RANGES];
+} RangeSet;
+
+typedef enum RANGE_RESULT {
+    // No usable Range header, the full representation is sent
+    RANGE_RESULT_NONE,
+    RANGE_RESULT_SATISFIABLE,
+    RANGE_RESULT_UNSATISFIABLE,
+} RANGE_RESULT;
+
+TimeOpt parseHttpDate(CharSlice value);
+size_t formatHttpDate(time_t time, char * buffer, size_t len);
+
+bool isNotModified(const Request * request, const FileMeta * meta);
+RANGE_RESULT parseRange(CharSlice value, off_t size, RangeSet * ranges);
+RANGE_RESULT evaluateRange(const Request * request, const FileMeta * meta, RangeSet * ranges);
+
+// Roots are searched in order, the first one holding the requested file serves it
+void serveFile(int conn_fd, const char * const * roots, size_t root_count, const Request * request, FileCache * cache);
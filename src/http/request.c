@@ -0,0 +1,116 @@
+/**
+ * Request line and header parser, slices point back into the source buffer
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+
+#include "http.h"
+
+static bool isOws(const char c) {
+    return (c == ' ' || c == '\t');
+}
+
+static CharSlice trimOws(CharSlice slice) {
+    while (slice.len > 0 && isOws(slice.ptr[0])) {
+        slice.ptr += 1;
+        slice.len -= 1;
+    }
+    while (slice.len > 0 && isOws(slice.ptr[slice.len - 1])) {
+        slice.len -= 1;
+    }
+    return slice;
+}
+
+// Splits off the next line, accepting both CRLF and a bare LF
+static bool nextLine(CharSlice *remaining, CharSlice *line) {
+    char * end = memchr(remaining->ptr, '\n', remaining->len);
+    if (end == NULL) {
+        return false;
+    }
+    size_t len = end - remaining->ptr;
+    line->ptr = remaining->ptr;
+    line->len = (len > 0 && end[-1] == '\r') ? len - 1 : len;
+    remaining->ptr += len + 1;
+    remaining->len -= len + 1;
+    return true;
+}
+
+static bool nextToken(CharSlice *line, CharSlice *token) {
+    char * end = memchr(line->ptr, ' ', line->len);
+    size_t len = (end == NULL) ? line->len : (size_t)(end - line->ptr);
+    token->ptr = line->ptr;
+    token->len = len;
+    line->ptr += (end == NULL) ? len : len + 1;
+    line->len -= (end == NULL) ? len : len + 1;
+    return len > 0;
+}
+
+RequestOrErr parseRequest(char *source, size_t len) {
+    Request request = { .header_count = 0 };
+    CharSlice remaining = { .ptr = source, .len = len };
+    CharSlice line;
+
+    if (!nextLine(&remaining, &line)
+        || !nextToken(&line, &request.method)
+        || !nextToken(&line, &request.target)
+        || !nextToken(&line, &request.version)
+        || line.len != 0) {
+        RequestOrErr error = AS_ERROR(HTTP_ERROR_BAD_REQUEST);
+        return error;
+    }
+
+    UriOrErr uri_err = (request.target.ptr[0] == '/' || request.target.ptr[0] == '*')
+        ? parseUriNoScheme(request.target.ptr, request.target.len)
+        : parseUri(request.target.ptr, request.target.len);
+    if (uri_err.option != OPTION_SOME) {
+        RequestOrErr error = AS_ERROR(HTTP_ERROR_BAD_REQUEST);
+        return error;
+    }
+    request.uri = uri_err.value;
+
+    while (true) {
+        if (!nextLine(&remaining, &line)) {
+            RequestOrErr error = AS_ERROR(HTTP_ERROR_BAD_REQUEST);
+            return error;
+        }
+        if (line.len == 0) {
+            break;
+        }
+
+        char * colon = memchr(line.ptr, ':', line.len);
+        if (colon == NULL || colon == line.ptr || isOws(colon[-1])) {
+            RequestOrErr error = AS_ERROR(HTTP_ERROR_BAD_REQUEST);
+            return error;
+        }
+        if (request.header_count == HTTP_MAX_HEADERS) {
+            RequestOrErr error = AS_ERROR(HTTP_ERROR_TOO_MANY_HEADERS);
+            return error;
+        }
+
+        size_t name_len = colon - line.ptr;
+        Header header = {
+            .name = { .ptr = line.ptr, .len = name_len },
+            .value = trimOws((CharSlice){ .ptr = colon + 1, .len = line.len - name_len - 1 }),
+        };
+        request.headers[request.header_count] = header;
+        request.header_count += 1;
+    }
+
+    RequestOrErr request_val = AS_VALUE(request);
+    return request_val;
+}
+
+StrOpt getHeader(const Request *request, const char *name) {
+    size_t len = strlen(name);
+    for (size_t i = 0; i < request->header_count; i++) {
+        const Header *header = &request->headers[i];
+        if (header->name.len == len && strncasecmp(header->name.ptr, name, len) == 0) {
+            StrOpt some = AS_SOME(header->value);
+            return some;
+        }
+    }
+    StrOpt none = AS_NONE();
+    return none;
+}
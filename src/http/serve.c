@@ -0,0 +1,266 @@
+/**
+ * Static file responses, bodies are sent straight from the page cache with sendfile
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+#include "http.h"
+
+#define HEADER_BUFFER_LEN 1024
+#define BOUNDARY "httpserver-c-byteranges"
+
+typedef struct ContentType {
+    const char * extension;
+    const char * type;
+} ContentType;
+
+static const ContentType content_types[] = {
+    { ".html", "text/html" },
+    { ".htm", "text/html" },
+    { ".css", "text/css" },
+    { ".js", "text/javascript" },
+    { ".json", "application/json" },
+    { ".txt", "text/plain" },
+    { ".png", "image/png" },
+    { ".jpg", "image/jpeg" },
+    { ".jpeg", "image/jpeg" },
+    { ".svg", "image/svg+xml" },
+};
+
+static const char * contentType(const char *path) {
+    const char * dot = strrchr(path, '.');
+    if (dot != NULL) {
+        for (size_t i = 0; i < sizeof(content_types) / sizeof(content_types[0]); i++) {
+            if (strcasecmp(dot, content_types[i].extension) == 0) {
+                return content_types[i].type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+static bool writeAll(int fd, const char *buffer, size_t len) {
+    while (len > 0) {
+        ssize_t num_write = write(fd, buffer, len);
+        if (num_write == -1) {
+            perror("write");
+            return false;
+        }
+        buffer += num_write;
+        len -= num_write;
+    }
+    return true;
+}
+
+static bool sendRange(int conn_fd, int file_fd, ByteRange range) {
+    off_t offset = range.first;
+    size_t remaining = range.last - range.first + 1;
+    while (remaining > 0) {
+        ssize_t num_sent = sendfile(conn_fd, file_fd, &offset, remaining);
+        if (num_sent == -1) {
+            perror("sendfile");
+            return false;
+        }
+        // File shrank underneath us, nothing more to send
+        if (num_sent == 0) {
+            return false;
+        }
+        remaining -= num_sent;
+    }
+    return true;
+}
+
+static void sendStatus(int conn_fd, const char *status, const char *extra_headers) {
+    char header[HEADER_BUFFER_LEN];
+    int len = snprintf(header, sizeof(header),
+                       "HTTP/1.1 %s\r\n"
+                       "Server: webserver-c\r\n"
+                       "Content-Length: 0\r\n"
+                       "Connection: close\r\n"
+                       "%s\r\n",
+                       status, extra_headers);
+    writeAll(conn_fd, header, len);
+}
+
+// 304 carries no Content-Length, a zero would contradict the length of the 200 it stands in for
+static void sendNotModified(int conn_fd, const char *validators) {
+    char header[HEADER_BUFFER_LEN];
+    int len = snprintf(header, sizeof(header),
+                       "HTTP/1.1 304 Not Modified\r\n"
+                       "Server: webserver-c\r\n"
+                       "Connection: close\r\n"
+                       "%s\r\n",
+                       validators);
+    writeAll(conn_fd, header, len);
+}
+
+static void formatValidators(const FileMeta *meta, char *buffer, size_t len) {
+    char last_modified[64];
+    formatHttpDate(meta->mtime, last_modified, sizeof(last_modified));
+    snprintf(buffer, len, "ETag: %s\r\nLast-Modified: %s\r\n", meta->etag, last_modified);
+}
+
+static int formatPartHeader(char *buffer, size_t len, const char *type, ByteRange range, off_t size) {
+    return snprintf(buffer, len,
+                    "\r\n--" BOUNDARY "\r\n"
+                    "Content-Type: %s\r\n"
+                    "Content-Range: bytes %lld-%lld/%lld\r\n\r\n",
+                    type, (long long)range.first, (long long)range.last, (long long)size);
+}
+
+// Maps the request path onto root, refusing anything that could climb out of it
+static bool resolvePath(const char *root, const Request *request, char *buffer, size_t len) {
+    if (request->uri.path.option != OPTION_SOME) {
+        return false;
+    }
+    CharSlice path = request->uri.path.some;
+    if (path.len == 0 || path.ptr[0] != '/' || memmem(path.ptr, path.len, "..", 2) != NULL
+        || memchr(path.ptr, '\0', path.len) != NULL) {
+        return false;
+    }
+    const char * index = (path.ptr[path.len - 1] == '/') ? "index.html" : "";
+    int written = snprintf(buffer, len, "%s%.*s%s", root, (int)path.len, path.ptr, index);
+    return written > 0 && (size_t)written < len;
+}
+
+void serveFile(int conn_fd, const char * const *roots, size_t root_count, const Request *request, FileCache *cache) {
+    bool is_head = request->method.len == 4 && strncmp(request->method.ptr, "HEAD", 4) == 0;
+    bool is_get = request->method.len == 3 && strncmp(request->method.ptr, "GET", 3) == 0;
+    if (!is_head && !is_get) {
+        sendStatus(conn_fd, "405 Method Not Allowed", "Allow: GET, HEAD\r\n");
+        return;
+    }
+
+    char path[PATH_MAX];
+    FileMetaOpt meta_opt = AS_NONE();
+    time_t now = time(NULL);
+    for (size_t i = 0; i < root_count && meta_opt.option != OPTION_SOME; i++) {
+        if (resolvePath(roots[i], request, path, sizeof(path))) {
+            meta_opt = fileCacheLookup(cache, path, now);
+        }
+    }
+    if (meta_opt.option != OPTION_SOME) {
+        sendStatus(conn_fd, "404 Not Found", "");
+        return;
+    }
+    FileMeta meta = meta_opt.some;
+
+    char validators[HEADER_BUFFER_LEN];
+    formatValidators(&meta, validators, sizeof(validators));
+
+    // Revalidation is answered from cached metadata alone, the file is never opened
+    if (isNotModified(request, &meta)) {
+        sendNotModified(conn_fd, validators);
+        return;
+    }
+
+    int file_fd = open(path, O_RDONLY);
+    if (file_fd == -1) {
+        sendStatus(conn_fd, "404 Not Found", "");
+        return;
+    }
+
+    // Headers describing a body must come from the file actually being sent, not the cache
+    struct stat st;
+    if (fstat(file_fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(file_fd);
+        sendStatus(conn_fd, "404 Not Found", "");
+        return;
+    }
+    FileMeta opened = fileMetaFromStat(&st);
+    if (opened.size != meta.size || opened.mtime != meta.mtime) {
+        meta = opened;
+        fileCacheStore(cache, path, &meta, now);
+        formatValidators(&meta, validators, sizeof(validators));
+        if (isNotModified(request, &meta)) {
+            close(file_fd);
+            sendNotModified(conn_fd, validators);
+            return;
+        }
+    }
+
+    RangeSet ranges;
+    RANGE_RESULT range_result = evaluateRange(request, &meta, &ranges);
+    if (range_result == RANGE_RESULT_UNSATISFIABLE) {
+        close(file_fd);
+        char content_range[64];
+        snprintf(content_range, sizeof(content_range), "Content-Range: bytes */%lld\r\n", (long long)meta.size);
+        sendStatus(conn_fd, "416 Range Not Satisfiable", content_range);
+        return;
+    }
+
+    const char * type = contentType(path);
+    char header[HEADER_BUFFER_LEN];
+    int header_len = 0;
+
+    if (range_result == RANGE_RESULT_NONE) {
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 200 OK\r\n"
+                              "Server: webserver-c\r\n"
+                              "Content-Type: %s\r\n"
+                              "Content-Length: %lld\r\n"
+                              "Accept-Ranges: bytes\r\n"
+                              "Connection: close\r\n"
+                              "%s\r\n",
+                              type, (long long)meta.size, validators);
+        if (writeAll(conn_fd, header, header_len) && !is_head && meta.size > 0) {
+            ByteRange all = { .first = 0, .last = meta.size - 1 };
+            sendRange(conn_fd, file_fd, all);
+        }
+    } else if (ranges.count == 1) {
+        ByteRange range = ranges.ranges[0];
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 206 Partial Content\r\n"
+                              "Server: webserver-c\r\n"
+                              "Content-Type: %s\r\n"
+                              "Content-Length: %lld\r\n"
+                              "Content-Range: bytes %lld-%lld/%lld\r\n"
+                              "Accept-Ranges: bytes\r\n"
+                              "Connection: close\r\n"
+                              "%s\r\n",
+                              type, (long long)(range.last - range.first + 1),
+                              (long long)range.first, (long long)range.last, (long long)meta.size,
+                              validators);
+        if (writeAll(conn_fd, header, header_len)) {
+            sendRange(conn_fd, file_fd, range);
+        }
+    } else {
+        char part[HEADER_BUFFER_LEN];
+        const char closing[] = "\r\n--" BOUNDARY "--\r\n";
+        long long content_length = strlen(closing);
+        for (size_t i = 0; i < ranges.count; i++) {
+            ByteRange range = ranges.ranges[i];
+            content_length += formatPartHeader(part, sizeof(part), type, range, meta.size);
+            content_length += range.last - range.first + 1;
+        }
+
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 206 Partial Content\r\n"
+                              "Server: webserver-c\r\n"
+                              "Content-Type: multipart/byteranges; boundary=" BOUNDARY "\r\n"
+                              "Content-Length: %lld\r\n"
+                              "Accept-Ranges: bytes\r\n"
+                              "Connection: close\r\n"
+                              "%s\r\n",
+                              content_length, validators);
+        bool ok = writeAll(conn_fd, header, header_len);
+        for (size_t i = 0; ok && i < ranges.count; i++) {
+            ByteRange range = ranges.ranges[i];
+            int part_len = formatPartHeader(part, sizeof(part), type, range, meta.size);
+            ok = writeAll(conn_fd, part, part_len) && sendRange(conn_fd, file_fd, range);
+        }
+        if (ok) {
+            writeAll(conn_fd, closing, strlen(closing));
+        }
+    }
+
+    close(file_fd);
+}
@@ -0,0 +1,487 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "http.h"
+
+#define TEST(NAME) static void NAME(void **state)
+
+// Mon, 02 Jan 2006 15:04:05 GMT
+#define MTIME 1136214245
+
+Request tryParseRequest(char * source) {
+    RequestOrErr request_err = parseRequest(source, strlen(source));
+    assert_int_equal(OPTION_SOME, request_err.option);
+    return request_err.value;
+}
+
+void expectEqualString2CharSlice(char * expected, CharSlice actual) {
+    char buffer[actual.len + 1];
+    strncpy(buffer, actual.ptr, actual.len);
+    buffer[actual.len] = '\0';
+    assert_string_equal(expected, buffer);
+}
+
+FileMeta testMeta(void) {
+    FileMeta meta = { .size = 1000, .mtime = MTIME, .etag = "\"abc\"", .etag_len = 5 };
+    return meta;
+}
+
+TEST(requestLine) {
+    (void) state;
+
+    Request request = tryParseRequest("GET /index.html?x=1 HTTP/1.1\r\nHost: example\r\n\r\n");
+
+    expectEqualString2CharSlice("GET", request.method);
+    expectEqualString2CharSlice("/index.html?x=1", request.target);
+    expectEqualString2CharSlice("HTTP/1.1", request.version);
+    expectEqualString2CharSlice("/index.html", request.uri.path.some);
+    expectEqualString2CharSlice("x=1", request.uri.query.some);
+}
+
+TEST(headers) {
+    (void) state;
+
+    Request request = tryParseRequest("GET / HTTP/1.1\r\nHost: example\r\nrange:  bytes=0-1 \r\n\r\n");
+
+    assert_int_equal(2, request.header_count);
+    expectEqualString2CharSlice("example", getHeader(&request, "host").some);
+    expectEqualString2CharSlice("bytes=0-1", getHeader(&request, "Range").some);
+    assert_int_equal(OPTION_NONE, getHeader(&request, "If-Range").option);
+}
+
+TEST(requestFail) {
+    (void) state;
+
+    char * sources[] = {
+        "",
+        "GET / HTTP/1.1",
+        "GET / HTTP/1.1\r\n",
+        "GET /\r\n\r\n",
+        "GET  / HTTP/1.1\r\n\r\n",
+        "GET / HTTP/1.1\r\nHost : example\r\n\r\n",
+        "GET / HTTP/1.1\r\nNoColon\r\n\r\n",
+    };
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        RequestOrErr err = parseRequest(sources[i], strlen(sources[i]));
+        assert_int_equal(OPTION_ERROR, err.option);
+        assert_int_equal(HTTP_ERROR_BAD_REQUEST, err.error);
+    }
+}
+
+TEST(httpDate) {
+    (void) state;
+
+    char * source = "Mon, 02 Jan 2006 15:04:05 GMT";
+    TimeOpt time = parseHttpDate((CharSlice){ .ptr = source, .len = strlen(source) });
+    assert_int_equal(OPTION_SOME, time.option);
+    assert_int_equal(MTIME, time.some);
+
+    char buffer[64];
+    formatHttpDate(MTIME, buffer, sizeof(buffer));
+    assert_string_equal(source, buffer);
+
+    source = "Monday, 02-Jan-06 15:04:05 GMT";
+    assert_int_equal(OPTION_NONE, parseHttpDate((CharSlice){ .ptr = source, .len = strlen(source) }).option);
+}
+
+TEST(ifNoneMatch) {
+    (void) state;
+    FileMeta meta = testMeta();
+
+    Request request = tryParseRequest("GET / HTTP/1.1\r\nIf-None-Match: \"abc\"\r\n\r\n");
+    assert_true(isNotModified(&request, &meta));
+
+    request = tryParseRequest("GET / HTTP/1.1\r\nIf-None-Match: \"x\", W/\"abc\"\r\n\r\n");
+    assert_true(isNotModified(&request, &meta));
+
+    request = tryParseRequest("HEAD / HTTP/1.1\r\nIf-None-Match: *\r\n\r\n");
+    assert_true(isNotModified(&request, &meta));
+
+    request = tryParseRequest("GET / HTTP/1.1\r\nIf-None-Match: \"abcd\"\r\n\r\n");
+    assert_false(isNotModified(&request, &meta));
+
+    request = tryParseRequest("POST / HTTP/1.1\r\nIf-None-Match: \"abc\"\r\n\r\n");
+    assert_false(isNotModified(&request, &meta));
+
+    // If-None-Match takes precedence over If-Modified-Since
+    request = tryParseRequest("GET / HTTP/1.1\r\nIf-None-Match: \"x\"\r\n"
+                              "If-Modified-Since: Mon, 02 Jan 2006 15:04:05 GMT\r\n\r\n");
+    assert_false(isNotModified(&request, &meta));
+}
+
+TEST(ifModifiedSince) {
+    (void) state;
+    FileMeta meta = testMeta();
+
+    Request request = tryParseRequest("GET / HTTP/1.1\r\nIf-Modified-Since: Mon, 02 Jan 2006 15:04:05 GMT\r\n\r\n");
+    assert_true(isNotModified(&request, &meta));
+
+    request = tryParseRequest("GET / HTTP/1.1\r\nIf-Modified-Since: Mon, 02 Jan 2006 15:04:04 GMT\r\n\r\n");
+    assert_false(isNotModified(&request, &meta));
+
+    request = tryParseRequest("GET / HTTP/1.1\r\nIf-Modified-Since: garbage\r\n\r\n");
+    assert_false(isNotModified(&request, &meta));
+}
+
+#define RANGE(VALUE) ((CharSlice){ .ptr = VALUE, .len = strlen(VALUE) })
+
+TEST(rangeSingle) {
+    (void) state;
+    RangeSet ranges;
+
+    assert_int_equal(RANGE_RESULT_SATISFIABLE, parseRange(RANGE("bytes=0-99"), 1000, &ranges));
+    assert_int_equal(1, ranges.count);
+    assert_int_equal(0, ranges.ranges[0].first);
+    assert_int_equal(99, ranges.ranges[0].last);
+
+    assert_int_equal(RANGE_RESULT_SATISFIABLE, parseRange(RANGE("bytes=900-"), 1000, &ranges));
+    assert_int_equal(900, ranges.ranges[0].first);
+    assert_int_equal(999, ranges.ranges[0].last);
+
+    assert_int_equal(RANGE_RESULT_SATISFIABLE, parseRange(RANGE("bytes=-100"), 1000, &ranges));
+    assert_int_equal(900, ranges.ranges[0].first);
+    assert_int_equal(999, ranges.ranges[0].last);
+
+    assert_int_equal(RANGE_RESULT_SATISFIABLE, parseRange(RANGE("bytes=-5000"), 1000, &ranges));
+    assert_int_equal(0, ranges.ranges[0].first);
+
+    assert_int_equal(RANGE_RESULT_SATISFIABLE, parseRange(RANGE("bytes=500-5000"), 1000, &ranges));
+    assert_int_equal(999, ranges.ranges[0].last);
+}
+
+TEST(rangeMultiple) {
+    (void) state;
+    RangeSet ranges;
+
+    assert_int_equal(RANGE_RESULT_SATISFIABLE, parseRange(RANGE("bytes=0-0, 10-19 ,2000-,-1"), 1000, &ranges));
+    assert_int_equal(3, ranges.count);
+    assert_int_equal(0, ranges.ranges[0].last);
+    assert_int_equal(10, ranges.ranges[1].first);
+    assert_int_equal(999, ranges.ranges[2].first);
+
+    assert_int_equal(RANGE_RESULT_NONE, parseRange(RANGE("bytes=0-0,1-1,2-2,3-3,4-4,5-5,6-6,7-7,8-8"), 1000, &ranges));
+}
+
+TEST(rangeInvalid) {
+    (void) state;
+    RangeSet ranges;
+
+    assert_int_equal(RANGE_RESULT_NONE, parseRange(RANGE("items=0-1"), 1000, &ranges));
+    assert_int_equal(RANGE_RESULT_NONE, parseRange(RANGE("bytes=5-1"), 1000, &ranges));
+    assert_int_equal(RANGE_RESULT_NONE, parseRange(RANGE("bytes=a-1"), 1000, &ranges));
+    assert_int_equal(RANGE_RESULT_NONE, parseRange(RANGE("bytes=1"), 1000, &ranges));
+    assert_int_equal(RANGE_RESULT_NONE, parseRange(RANGE("bytes="), 1000, &ranges));
+    assert_int_equal(RANGE_RESULT_NONE, parseRange(RANGE("bytes=99999999999999999999-"), 1000, &ranges));
+
+    assert_int_equal(RANGE_RESULT_UNSATISFIABLE, parseRange(RANGE("bytes=1000-"), 1000, &ranges));
+    assert_int_equal(RANGE_RESULT_UNSATISFIABLE, parseRange(RANGE("bytes=-0"), 1000, &ranges));
+    assert_int_equal(RANGE_RESULT_UNSATISFIABLE, parseRange(RANGE("bytes=0-"), 0, &ranges));
+}
+
+TEST(ifRange) {
+    (void) state;
+    FileMeta meta = testMeta();
+    RangeSet ranges;
+
+    Request request = tryParseRequest("GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: \"abc\"\r\n\r\n");
+    assert_int_equal(RANGE_RESULT_SATISFIABLE, evaluateRange(&request, &meta, &ranges));
+
+    request = tryParseRequest("GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: W/\"abc\"\r\n\r\n");
+    assert_int_equal(RANGE_RESULT_NONE, evaluateRange(&request, &meta, &ranges));
+
+    request = tryParseRequest("GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: Mon, 02 Jan 2006 15:04:05 GMT\r\n\r\n");
+    assert_int_equal(RANGE_RESULT_SATISFIABLE, evaluateRange(&request, &meta, &ranges));
+
+    request = tryParseRequest("GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: Mon, 02 Jan 2006 15:04:04 GMT\r\n\r\n");
+    assert_int_equal(RANGE_RESULT_NONE, evaluateRange(&request, &meta, &ranges));
+
+    request = tryParseRequest("HEAD / HTTP/1.1\r\nRange: bytes=0-1\r\n\r\n");
+    assert_int_equal(RANGE_RESULT_NONE, evaluateRange(&request, &meta, &ranges));
+}
+
+TEST(fileCache) {
+    (void) state;
+    FileCache cache = { .entries = NULL };
+    FileMeta meta = testMeta();
+    char path[32];
+
+    // Well past the old inline array, every path can land in its own slot
+    assert_true(fileCacheInit(&cache, 4096, 60));
+    assert_int_equal(4096, cache.len);
+    for (int i = 0; i < 256; i++) {
+        snprintf(path, sizeof(path), "/nonexistent/%d", i);
+        fileCacheStore(&cache, path, &meta, MTIME);
+    }
+
+    // Inside the TTL the stored metadata is returned without looking at the path
+    FileMetaOpt cached = fileCacheLookup(&cache, "/nonexistent/7", MTIME + 59);
+    assert_int_equal(OPTION_SOME, cached.option);
+    assert_int_equal(meta.size, cached.some.size);
+    assert_string_equal(meta.etag, cached.some.etag);
+
+    assert_int_equal(OPTION_NONE, fileCacheLookup(&cache, "/nonexistent/7", MTIME + 60).option);
+
+    // Initialising again resizes and forgets everything
+    fileCacheStore(&cache, "/nonexistent/7", &meta, MTIME);
+    assert_true(fileCacheInit(&cache, 2, 60));
+    assert_int_equal(2, cache.len);
+    assert_int_equal(OPTION_NONE, fileCacheLookup(&cache, "/nonexistent/7", MTIME).option);
+
+    assert_true(fileCacheInit(&cache, FILE_CACHE_MAX_LEN + 1, 60));
+    assert_int_equal(FILE_CACHE_MAX_LEN, cache.len);
+
+    fileCacheFree(&cache);
+    assert_null(cache.entries);
+}
+
+// Scratch document root holding a single a.txt
+typedef struct ServeFixture {
+    char root[32];
+    char path[64];
+    const char * roots[1];
+    FileCache cache;
+} ServeFixture;
+
+void writeTestFile(ServeFixture * fixture, const char * content, time_t mtime) {
+    FILE * file = fopen(fixture->path, "wb");
+    assert_non_null(file);
+    assert_int_equal(strlen(content), fwrite(content, 1, strlen(content), file));
+    fclose(file);
+    struct utimbuf times = { .actime = mtime, .modtime = mtime };
+    assert_int_equal(0, utime(fixture->path, &times));
+}
+
+void openServeFixture(ServeFixture * fixture, time_t ttl) {
+    strcpy(fixture->root, "/tmp/http_tester.XXXXXX");
+    assert_non_null(mkdtemp(fixture->root));
+    snprintf(fixture->path, sizeof(fixture->path), "%s/a.txt", fixture->root);
+    fixture->roots[0] = fixture->root;
+    fixture->cache.entries = NULL;
+    assert_true(fileCacheInit(&fixture->cache, 8, ttl));
+    writeTestFile(fixture, "0123456789abcdefghij", MTIME);
+}
+
+void closeServeFixture(ServeFixture * fixture) {
+    fileCacheFree(&fixture->cache);
+    unlink(fixture->path);
+    rmdir(fixture->root);
+}
+
+// Runs serveFile against one end of a socketpair and returns everything written to it
+void serve(ServeFixture * fixture, char * request_source, char * response, size_t len) {
+    Request request = tryParseRequest(request_source);
+    int fds[2];
+    assert_int_equal(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    serveFile(fds[0], fixture->roots, 1, &request, &fixture->cache);
+    close(fds[0]);
+
+    size_t total = 0;
+    ssize_t num_read;
+    while (total < len - 1 && (num_read = read(fds[1], response + total, len - 1 - total)) > 0) {
+        total += num_read;
+    }
+    response[total] = '\0';
+    close(fds[1]);
+}
+
+TEST(serveFull) {
+    (void) state;
+    ServeFixture fixture;
+    openServeFixture(&fixture, 60);
+    char response[1024];
+
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\n\r\n", response, sizeof(response));
+    assert_string_equal("HTTP/1.1 200 OK\r\n"
+                        "Server: webserver-c\r\n"
+                        "Content-Type: text/plain\r\n"
+                        "Content-Length: 20\r\n"
+                        "Accept-Ranges: bytes\r\n"
+                        "Connection: close\r\n"
+                        "ETag: \"43b940e5-14\"\r\n"
+                        "Last-Modified: Mon, 02 Jan 2006 15:04:05 GMT\r\n"
+                        "\r\n"
+                        "0123456789abcdefghij", response);
+
+    serve(&fixture, "HEAD /a.txt HTTP/1.1\r\n\r\n", response, sizeof(response));
+    assert_non_null(strstr(response, "Content-Length: 20\r\n"));
+    assert_string_equal("\r\n\r\n", response + strlen(response) - 4);
+
+    serve(&fixture, "GET /missing.txt HTTP/1.1\r\n\r\n", response, sizeof(response));
+    assert_string_equal("HTTP/1.1 404 Not Found\r\n"
+                        "Server: webserver-c\r\n"
+                        "Content-Length: 0\r\n"
+                        "Connection: close\r\n"
+                        "\r\n", response);
+
+    closeServeFixture(&fixture);
+}
+
+TEST(serveNotModified) {
+    (void) state;
+    ServeFixture fixture;
+    openServeFixture(&fixture, 60);
+    char response[1024];
+
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\n\r\n", response, sizeof(response));
+
+    // With the file gone only the cache can answer, so this proves no stat() or open() happens
+    unlink(fixture.path);
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\nIf-None-Match: \"43b940e5-14\"\r\n\r\n", response, sizeof(response));
+    assert_string_equal("HTTP/1.1 304 Not Modified\r\n"
+                        "Server: webserver-c\r\n"
+                        "Connection: close\r\n"
+                        "ETag: \"43b940e5-14\"\r\n"
+                        "Last-Modified: Mon, 02 Jan 2006 15:04:05 GMT\r\n"
+                        "\r\n", response);
+
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\nIf-Modified-Since: Mon, 02 Jan 2006 15:04:05 GMT\r\n\r\n",
+          response, sizeof(response));
+    assert_memory_equal("HTTP/1.1 304 Not Modified\r\n", response, 27);
+    assert_null(strstr(response, "Content-Length"));
+
+    closeServeFixture(&fixture);
+}
+
+TEST(serveRange) {
+    (void) state;
+    ServeFixture fixture;
+    openServeFixture(&fixture, 60);
+    char response[1024];
+
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\nRange: bytes=2-5\r\n\r\n", response, sizeof(response));
+    assert_string_equal("HTTP/1.1 206 Partial Content\r\n"
+                        "Server: webserver-c\r\n"
+                        "Content-Type: text/plain\r\n"
+                        "Content-Length: 4\r\n"
+                        "Content-Range: bytes 2-5/20\r\n"
+                        "Accept-Ranges: bytes\r\n"
+                        "Connection: close\r\n"
+                        "ETag: \"43b940e5-14\"\r\n"
+                        "Last-Modified: Mon, 02 Jan 2006 15:04:05 GMT\r\n"
+                        "\r\n"
+                        "2345", response);
+
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\nRange: bytes=50-60\r\n\r\n", response, sizeof(response));
+    assert_string_equal("HTTP/1.1 416 Range Not Satisfiable\r\n"
+                        "Server: webserver-c\r\n"
+                        "Content-Length: 0\r\n"
+                        "Connection: close\r\n"
+                        "Content-Range: bytes */20\r\n"
+                        "\r\n", response);
+
+    closeServeFixture(&fixture);
+}
+
+TEST(serveMultipart) {
+    (void) state;
+    ServeFixture fixture;
+    openServeFixture(&fixture, 60);
+    char response[2048];
+
+    const char * body = "\r\n--httpserver-c-byteranges\r\n"
+                        "Content-Type: text/plain\r\n"
+                        "Content-Range: bytes 0-1/20\r\n"
+                        "\r\n"
+                        "01"
+                        "\r\n--httpserver-c-byteranges\r\n"
+                        "Content-Type: text/plain\r\n"
+                        "Content-Range: bytes 15-19/20\r\n"
+                        "\r\n"
+                        "fghij"
+                        "\r\n--httpserver-c-byteranges--\r\n";
+    char expected[2048];
+    snprintf(expected, sizeof(expected),
+             "HTTP/1.1 206 Partial Content\r\n"
+             "Server: webserver-c\r\n"
+             "Content-Type: multipart/byteranges; boundary=httpserver-c-byteranges\r\n"
+             "Content-Length: %zu\r\n"
+             "Accept-Ranges: bytes\r\n"
+             "Connection: close\r\n"
+             "ETag: \"43b940e5-14\"\r\n"
+             "Last-Modified: Mon, 02 Jan 2006 15:04:05 GMT\r\n"
+             "\r\n"
+             "%s", strlen(body), body);
+
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\nRange: bytes=0-1,-5\r\n\r\n", response, sizeof(response));
+    assert_string_equal(expected, response);
+
+    closeServeFixture(&fixture);
+}
+
+TEST(serveChangedFile) {
+    (void) state;
+    ServeFixture fixture;
+    openServeFixture(&fixture, 60);
+    char response[1024];
+
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\n\r\n", response, sizeof(response));
+
+    // Still inside the TTL, the cache holds the old size and validators
+    writeTestFile(&fixture, "changed", MTIME + 10);
+    FileMetaOpt cached = fileCacheLookup(&fixture.cache, fixture.path, time(NULL));
+    assert_int_equal(OPTION_SOME, cached.option);
+    assert_int_equal(20, cached.some.size);
+
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\n\r\n", response, sizeof(response));
+    assert_string_equal("HTTP/1.1 200 OK\r\n"
+                        "Server: webserver-c\r\n"
+                        "Content-Type: text/plain\r\n"
+                        "Content-Length: 7\r\n"
+                        "Accept-Ranges: bytes\r\n"
+                        "Connection: close\r\n"
+                        "ETag: \"43b940ef-7\"\r\n"
+                        "Last-Modified: Mon, 02 Jan 2006 15:04:15 GMT\r\n"
+                        "\r\n"
+                        "changed", response);
+
+    cached = fileCacheLookup(&fixture.cache, fixture.path, time(NULL));
+    assert_int_equal(7, cached.some.size);
+
+    // A stale entry is refreshed from the opened file before If-None-Match is decided
+    writeTestFile(&fixture, "changed again", MTIME + 20);
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\nIf-None-Match: \"43b940f9-d\"\r\n\r\n", response, sizeof(response));
+    assert_string_equal("HTTP/1.1 304 Not Modified\r\n"
+                        "Server: webserver-c\r\n"
+                        "Connection: close\r\n"
+                        "ETag: \"43b940f9-d\"\r\n"
+                        "Last-Modified: Mon, 02 Jan 2006 15:04:25 GMT\r\n"
+                        "\r\n", response);
+
+    writeTestFile(&fixture, "short", MTIME + 30);
+    serve(&fixture, "GET /a.txt HTTP/1.1\r\nRange: bytes=10-\r\n\r\n", response, sizeof(response));
+    assert_memory_equal("HTTP/1.1 416 Range Not Satisfiable\r\n", response, 36);
+    assert_non_null(strstr(response, "Content-Range: bytes */5\r\n"));
+
+    closeServeFixture(&fixture);
+}
+
+int main(int argc, char *argv[]) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(requestLine),
+        cmocka_unit_test(headers),
+        cmocka_unit_test(requestFail),
+        cmocka_unit_test(httpDate),
+        cmocka_unit_test(ifNoneMatch),
+        cmocka_unit_test(ifModifiedSince),
+        cmocka_unit_test(rangeSingle),
+        cmocka_unit_test(rangeMultiple),
+        cmocka_unit_test(rangeInvalid),
+        cmocka_unit_test(ifRange),
+        cmocka_unit_test(fileCache),
+        cmocka_unit_test(serveFull),
+        cmocka_unit_test(serveNotModified),
+        cmocka_unit_test(serveRange),
+        cmocka_unit_test(serveMultipart),
+        cmocka_unit_test(serveChangedFile),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
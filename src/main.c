@@ -1,82 +1,67 @@
-#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <sys/socket.h>
-#include <unistd.h>
-#include <arpa/inet.h>
+#include <time.h>
 
-#define PORT 42069
-#define BUFFER_LEN 1024
+#include "config/config.h"
+#include "server/server.h"
 
-int main(int argc, char *argv[]) {
-
-    int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd == -1) {
-        perror("socket");
-        return EXIT_FAILURE;
-    }
-
-    struct sockaddr_in host_addr;
-    socklen_t host_addr_len = sizeof(host_addr);
+#define RECLAIM_INTERVAL_SEC 1
 
-    host_addr.sin_family = AF_INET;
-    host_addr.sin_port = htons(PORT);
-    host_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+static Server server;
 
-    if (bind(socket_fd, (struct sockaddr *)&host_addr, host_addr_len) == -1) {
-        perror("bind");
-        return EXIT_FAILURE;
+static bool readConfig(const char *path, Config *config) {
+    if (path == NULL) {
+        *config = defaultConfig();
+        return true;
     }
 
-    if (listen(socket_fd, 128) == -1) {
-        perror("listen");
-        return EXIT_FAILURE;
+    ConfigOrErr config_err = loadConfig(path);
+    if (config_err.option != OPTION_SOME) {
+        fprintf(stderr, "%s:%zu: %s\n", path, config_err.error.line, configErrorName(config_err.error.error));
+        return false;
     }
+    *config = config_err.value;
+    return true;
+}
 
-    printf("listening on port %d...\n", PORT);
+int main(int argc, char *argv[]) {
 
-    char buffer[BUFFER_LEN];
-    char resp[] = "HTTP/1.0 200 OK\r\n"
-                    "Server: webserver-c\r\n"
-                    "Content-type: text/html\r\n\r\n"
-                    "<html>hello, world</html>\r\n";
+    // A client dropping a download half way must not take the server with it
+    signal(SIGPIPE, SIG_IGN);
 
-    struct sockaddr_in client_addr;
-    socklen_t client_addr_len = sizeof(client_addr);
+    const char *config_path = (argc > 1) ? argv[1] : NULL;
 
-    while (1) {
-        int conn_fd = accept(socket_fd, (struct sockaddr *)&host_addr, &host_addr_len);
-        if (conn_fd == -1) {
-            perror("accept");
-            continue;
-        }
-
-        // getpeername?
-        if (getsockname(conn_fd, (struct sockaddr *)&client_addr, &client_addr_len) == -1) {
-            perror("client name");
-            continue;
-        }
+    Config config;
+    if (!readConfig(config_path, &config)) {
+        return EXIT_FAILURE;
+    }
 
-        printf("[%s:%u] - connection accepted\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+    // Blocked before the workers start so only sigtimedwait below ever sees SIGHUP
+    sigset_t reload_set;
+    sigemptyset(&reload_set);
+    sigaddset(&reload_set, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &reload_set, NULL);
 
-        ssize_t num_read = read(conn_fd, (void*)buffer, BUFFER_LEN);
-        if (num_read == -1) {
-            perror("read");
-            // close?
-            continue;
-        }
+    if (!serverStart(&server, &config)) {
+        return EXIT_FAILURE;
+    }
 
-        printf("[%s:%u] - %s\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port), buffer);
+    struct timespec timeout = { .tv_sec = RECLAIM_INTERVAL_SEC, .tv_nsec = 0 };
 
-        ssize_t num_write = write(conn_fd, resp, strlen(resp));
-        if (num_write == -1) {
-            perror("write");
-            // close?
-            continue;
+    while (1) {
+        if (sigtimedwait(&reload_set, NULL, &timeout) == SIGHUP) {
+            if (config_path == NULL) {
+                printf("no config file given, nothing to reload\n");
+            } else if (readConfig(config_path, &config) && serverReload(&server, &config)) {
+                printf("reloaded %s\n", config_path);
+            } else {
+                fprintf(stderr, "reload failed, keeping the previous configuration\n");
+            }
         }
 
-        close(conn_fd);
+        serverReclaim(&server);
     }
 
     return EXIT_SUCCESS;
@@ -0,0 +1,222 @@
+/**
+ * Listening sockets, worker threads and configuration snapshot lifetime
+ *
+ * Only the main thread calls into this file, workers just load server->current.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "server.h"
+
+void formatSockAddress(const struct sockaddr_storage *addr, char *buffer, size_t len) {
+    char host[INET6_ADDRSTRLEN] = "?";
+    if (addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)addr;
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        snprintf(buffer, len, "[%s]:%u", host, ntohs(in6->sin6_port));
+    } else {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        snprintf(buffer, len, "%s:%u", host, ntohs(in->sin_port));
+    }
+}
+
+static int openListener(const ListenAddress *listen_addr, int backlog) {
+    char name[INET6_ADDRSTRLEN + 8];
+    formatSockAddress(&listen_addr->addr, name, sizeof(name));
+
+    // Non blocking so workers racing on the same ready socket don't stall in accept()
+    int socket_fd = socket(listen_addr->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_fd == -1) {
+        perror("socket");
+        return -1;
+    }
+
+    int on = 1;
+    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    // Lets "[::]" and "0.0.0.0" be listed side by side
+    if (listen_addr->addr.ss_family == AF_INET6) {
+        setsockopt(socket_fd, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on));
+    }
+
+    if (bind(socket_fd, (const struct sockaddr *)&listen_addr->addr, listen_addr->addr_len) == -1) {
+        perror("bind");
+        close(socket_fd);
+        return -1;
+    }
+
+    if (listen(socket_fd, backlog) == -1) {
+        perror("listen");
+        close(socket_fd);
+        return -1;
+    }
+
+    printf("listening on %s...\n", name);
+    return socket_fd;
+}
+
+static ConfigSnapshot *createSnapshot(Server *server, const Config *config, ConfigSnapshot *previous) {
+    ConfigSnapshot *snapshot = calloc(1, sizeof(*snapshot));
+    if (snapshot == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+    snapshot->config = *config;
+    for (size_t i = 0; i < config->root_count; i++) {
+        snapshot->roots[i] = snapshot->config.roots[i];
+    }
+
+    // Sockets for addresses that stay are carried over so nothing queued on them is lost
+    int carried[CONFIG_MAX_LISTEN];
+    // A previous socket is handed to at most one slot, two owners would close it twice
+    bool taken[CONFIG_MAX_LISTEN] = { false };
+    for (size_t i = 0; i < config->listen_count; i++) {
+        carried[i] = -1;
+        if (previous != NULL) {
+            for (size_t j = 0; j < previous->config.listen_count; j++) {
+                if (previous->owns_fd[j] && !taken[j]
+                    && sameListenAddress(&config->listen[i], &previous->config.listen[j])) {
+                    carried[i] = (int)j;
+                    taken[j] = true;
+                    break;
+                }
+            }
+        }
+
+        if (carried[i] != -1) {
+            snapshot->listen_fds[i] = previous->listen_fds[carried[i]];
+            continue;
+        }
+
+        snapshot->listen_fds[i] = openListener(&config->listen[i], config->backlog);
+        if (snapshot->listen_fds[i] == -1) {
+            for (size_t k = 0; k < i; k++) {
+                if (carried[k] == -1) {
+                    close(snapshot->listen_fds[k]);
+                }
+            }
+            free(snapshot);
+            return NULL;
+        }
+    }
+
+    // Nothing can fail past this point, so the running sockets are only touched now
+    for (size_t i = 0; i < config->listen_count; i++) {
+        snapshot->owns_fd[i] = true;
+        if (carried[i] != -1) {
+            previous->owns_fd[carried[i]] = false;
+            // Calling listen() again on a listening socket only updates its backlog
+            if (listen(snapshot->listen_fds[i], config->backlog) == -1) {
+                perror("listen");
+            }
+        }
+    }
+
+    server->generation += 1;
+    snapshot->generation = server->generation;
+    return snapshot;
+}
+
+static void freeSnapshot(ConfigSnapshot *snapshot) {
+    for (size_t i = 0; i < snapshot->config.listen_count; i++) {
+        if (snapshot->owns_fd[i]) {
+            close(snapshot->listen_fds[i]);
+        }
+    }
+    free(snapshot);
+}
+
+static void joinWorker(Worker *worker) {
+    pthread_join(worker->thread, NULL);
+    worker->started = false;
+}
+
+static void spawnWorkers(Server *server, const ConfigSnapshot *snapshot) {
+    for (size_t i = 0; i < snapshot->config.workers; i++) {
+        Worker *worker = &server->workers[i];
+        if (worker->started && !atomic_load(&worker->exited)) {
+            continue;
+        }
+        if (worker->started) {
+            joinWorker(worker);
+        }
+
+        worker->server = server;
+        worker->index = i;
+        atomic_store(&worker->seen, snapshot->generation);
+        atomic_store(&worker->exited, false);
+        int error = pthread_create(&worker->thread, NULL, workerMain, worker);
+        if (error != 0) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(error));
+            atomic_store(&worker->seen, SERVER_OFFLINE);
+            continue;
+        }
+        worker->started = true;
+    }
+}
+
+bool serverStart(Server *server, const Config *config) {
+    for (size_t i = 0; i < CONFIG_MAX_WORKERS; i++) {
+        atomic_store(&server->workers[i].seen, SERVER_OFFLINE);
+    }
+    server->retired = NULL;
+    server->generation = 0;
+
+    ConfigSnapshot *snapshot = createSnapshot(server, config, NULL);
+    if (snapshot == NULL) {
+        return false;
+    }
+    atomic_store(&server->current, snapshot);
+    spawnWorkers(server, snapshot);
+    return true;
+}
+
+bool serverReload(Server *server, const Config *config) {
+    ConfigSnapshot *previous = atomic_load(&server->current);
+    ConfigSnapshot *snapshot = createSnapshot(server, config, previous);
+    if (snapshot == NULL) {
+        return false;
+    }
+
+    atomic_store(&server->current, snapshot);
+    previous->retired_next = server->retired;
+    server->retired = previous;
+
+    spawnWorkers(server, snapshot);
+    return true;
+}
+
+void serverReclaim(Server *server) {
+    uint64_t min_seen = SERVER_OFFLINE;
+    for (size_t i = 0; i < CONFIG_MAX_WORKERS; i++) {
+        Worker *worker = &server->workers[i];
+        if (worker->started && atomic_load(&worker->exited)) {
+            joinWorker(worker);
+        }
+        uint64_t seen = atomic_load(&worker->seen);
+        if (seen < min_seen) {
+            min_seen = seen;
+        }
+    }
+
+    // A retired snapshot is unreachable once every worker has loaded something newer
+    ConfigSnapshot **link = &server->retired;
+    while (*link != NULL) {
+        ConfigSnapshot *snapshot = *link;
+        if (snapshot->generation < min_seen) {
+            *link = snapshot->retired_next;
+            freeSnapshot(snapshot);
+        } else {
+            link = &snapshot->retired_next;
+        }
+    }
+
+    // Workers that quit on a scale down racing a scale up, or on an error, are brought back
+    spawnWorkers(server, atomic_load(&server->current));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../config/config.h"
+#include "../http/http.h"
+
+// How long a worker may sit in poll() before it looks for a newer snapshot
+#define SERVER_POLL_MS 500
+// Seen generation of a worker that holds no snapshot
+#define SERVER_OFFLINE UINT64_MAX
+
+/**
+ * Immutable view of the configuration that workers read without locking.
+ *
+ * Reloads publish a new snapshot and retire the old one, which is freed once
+ * every worker has passed a quiescent point (between connections) after the
+ * publish, in the manner of QSBR flavoured RCU.
+ */
+typedef struct ConfigSnapshot {
+    Config config;
+    uint64_t generation;
+    int listen_fds[CONFIG_MAX_LISTEN];
+    // Cleared when a later snapshot takes over the socket, only touched by the main thread
+    bool owns_fd[CONFIG_MAX_LISTEN];
+    const char * roots[CONFIG_MAX_ROOTS];
+    struct ConfigSnapshot * retired_next;
+} ConfigSnapshot;
+
+typedef struct Server Server;
+
+typedef struct Worker {
+    Server * server;
+    size_t index;
+    pthread_t thread;
+    bool started;
+    _Atomic uint64_t seen;
+    atomic_bool exited;
+    FileCache cache;
+} Worker;
+
+struct Server {
+    _Atomic(ConfigSnapshot *) current;
+    ConfigSnapshot * retired;
+    uint64_t generation;
+    Worker workers[CONFIG_MAX_WORKERS];
+};
+
+void formatSockAddress(const struct sockaddr_storage * addr, char * buffer, size_t len);
+
+bool serverStart(Server * server, const Config * config);
+bool serverReload(Server * server, const Config * config);
+void serverReclaim(Server * server);
+
+void * workerMain(void * arg);
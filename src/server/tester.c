@@ -0,0 +1,272 @@
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include "server.h"
+
+#define TEST(NAME) static void NAME(void **state)
+
+// Workers refresh their snapshot at least every SERVER_POLL_MS, give them a few rounds
+#define RECLAIM_WAIT_MS (SERVER_POLL_MS * 6)
+#define RECLAIM_STEP_MS 50
+
+// 127.0.0.<host>, port 0 lets the kernel pick so nothing collides between runs
+ListenAddress loopback(uint8_t host) {
+    ListenAddress listen_addr;
+    memset(&listen_addr, 0, sizeof(listen_addr));
+    struct sockaddr_in *addr = (struct sockaddr_in *)&listen_addr.addr;
+    addr->sin_family = AF_INET;
+    addr->sin_port = 0;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK - 1 + host);
+    listen_addr.addr_len = sizeof(*addr);
+    return listen_addr;
+}
+
+Config testConfig(ListenAddress * listen, size_t listen_count) {
+    Config config = defaultConfig();
+    config.listen_count = listen_count;
+    for (size_t i = 0; i < listen_count; i++) {
+        config.listen[i] = listen[i];
+    }
+    return config;
+}
+
+bool isOpen(int fd) {
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+int connectTo(int listen_fd) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) == -1) {
+        return -1;
+    }
+    int client_fd = socket(addr.ss_family, SOCK_STREAM, 0);
+    if (connect(client_fd, (struct sockaddr *)&addr, addr_len) == -1) {
+        close(client_fd);
+        return -1;
+    }
+    return client_fd;
+}
+
+bool acceptsConnections(int fd) {
+    int client_fd = connectTo(fd);
+    close(client_fd);
+    return client_fd != -1;
+}
+
+void sendText(int fd, const char * text) {
+    assert_int_equal(strlen(text), write(fd, text, strlen(text)));
+}
+
+// Reads until the server closes the connection
+size_t readResponse(int fd, char * buffer, size_t len) {
+    size_t total = 0;
+    ssize_t num_read;
+    while (total < len - 1 && (num_read = read(fd, buffer + total, len - 1 - total)) > 0) {
+        total += num_read;
+    }
+    buffer[total] = '\0';
+    return total;
+}
+
+bool waitReclaimed(Server * server) {
+    for (int waited = 0; waited < RECLAIM_WAIT_MS; waited += RECLAIM_STEP_MS) {
+        serverReclaim(server);
+        if (server->retired == NULL) {
+            return true;
+        }
+        usleep(RECLAIM_STEP_MS * 1000);
+    }
+    return false;
+}
+
+TEST(carryOver) {
+    (void) state;
+    static Server server;
+
+    ListenAddress first[] = { loopback(1), loopback(2) };
+    Config config = testConfig(first, 2);
+    assert_true(serverStart(&server, &config));
+    ConfigSnapshot *previous = atomic_load(&server.current);
+    int kept_fd = previous->listen_fds[0];
+    int dropped_fd = previous->listen_fds[1];
+
+    ListenAddress second[] = { loopback(1), loopback(3) };
+    config = testConfig(second, 2);
+    config.backlog = 512;
+    assert_true(serverReload(&server, &config));
+    ConfigSnapshot *current = atomic_load(&server.current);
+
+    assert_int_equal(previous->generation + 1, current->generation);
+    assert_ptr_equal(previous, server.retired);
+    assert_int_equal(kept_fd, current->listen_fds[0]);
+    assert_true(current->owns_fd[0]);
+    assert_true(current->owns_fd[1]);
+    assert_false(previous->owns_fd[0]);
+    assert_true(previous->owns_fd[1]);
+
+    assert_true(waitReclaimed(&server));
+    assert_true(isOpen(kept_fd));
+    assert_false(isOpen(dropped_fd));
+    assert_true(acceptsConnections(current->listen_fds[0]));
+    assert_true(acceptsConnections(current->listen_fds[1]));
+}
+
+TEST(duplicateCarry) {
+    (void) state;
+    static Server server;
+
+    // Port 0 lets the same address bind twice, each slot must keep its own socket
+    ListenAddress twice[] = { loopback(1), loopback(1) };
+    Config config = testConfig(twice, 2);
+    assert_true(serverStart(&server, &config));
+
+    assert_true(serverReload(&server, &config));
+    ConfigSnapshot *middle = atomic_load(&server.current);
+    assert_true(middle->listen_fds[0] != middle->listen_fds[1]);
+
+    ListenAddress once[] = { loopback(1) };
+    config = testConfig(once, 1);
+    assert_true(serverReload(&server, &config));
+    ConfigSnapshot *current = atomic_load(&server.current);
+    int live_fd = current->listen_fds[0];
+
+    assert_true(waitReclaimed(&server));
+    assert_true(isOpen(live_fd));
+    assert_true(acceptsConnections(live_fd));
+}
+
+TEST(failedReload) {
+    (void) state;
+    static Server server;
+
+    ListenAddress first[] = { loopback(1) };
+    Config config = testConfig(first, 1);
+    assert_true(serverStart(&server, &config));
+    ConfigSnapshot *current = atomic_load(&server.current);
+    int fd = current->listen_fds[0];
+
+    // TEST-NET-1 is never a local address, so the bind fails
+    ListenAddress second[] = { loopback(1), loopback(1) };
+    struct sockaddr_in *unbindable = (struct sockaddr_in *)&second[1].addr;
+    inet_pton(AF_INET, "192.0.2.1", &unbindable->sin_addr);
+    config = testConfig(second, 2);
+    assert_false(serverReload(&server, &config));
+
+    assert_ptr_equal(current, atomic_load(&server.current));
+    assert_null(server.retired);
+    assert_true(current->owns_fd[0]);
+    assert_true(isOpen(fd));
+    assert_true(acceptsConnections(fd));
+}
+
+TEST(reclaimGeneration) {
+    (void) state;
+    static Server server;
+
+    ListenAddress first[] = { loopback(1) };
+    Config config = testConfig(first, 1);
+    assert_true(serverStart(&server, &config));
+    ConfigSnapshot *previous = atomic_load(&server.current);
+    uint64_t old_generation = previous->generation;
+
+    assert_true(serverReload(&server, &config));
+
+    // An unused slot stands in for a worker still serving on the old snapshot
+    Worker *pinned = &server.workers[CONFIG_MAX_WORKERS - 1];
+    atomic_store(&pinned->seen, old_generation);
+    assert_false(waitReclaimed(&server));
+    assert_ptr_equal(previous, server.retired);
+
+    atomic_store(&pinned->seen, old_generation + 1);
+    assert_true(waitReclaimed(&server));
+
+    atomic_store(&pinned->seen, SERVER_OFFLINE);
+}
+
+TEST(partialRequest) {
+    (void) state;
+    static Server server;
+
+    ListenAddress first[] = { loopback(1) };
+    Config config = testConfig(first, 1);
+    assert_true(serverStart(&server, &config));
+    int listen_fd = atomic_load(&server.current)->listen_fds[0];
+    char response[256];
+
+    // The header block arrives in two reads, the request must still be parsed whole
+    int client_fd = connectTo(listen_fd);
+    assert_true(client_fd != -1);
+    sendText(client_fd, "GET /does-not-exist.txt HTTP/1.1\r\n");
+    usleep(300 * 1000);
+    sendText(client_fd, "Host: x\r\n\r\n");
+    readResponse(client_fd, response, sizeof(response));
+    close(client_fd);
+    assert_memory_equal("HTTP/1.1 404 Not Found\r\n", response, 24);
+
+    // Headers that never end before the buffer fills up
+    char long_header[CONFIG_DEFAULT_BUFFER_LEN + 1];
+    memset(long_header, 'a', sizeof(long_header) - 1);
+    long_header[sizeof(long_header) - 1] = '\0';
+    client_fd = connectTo(listen_fd);
+    assert_true(client_fd != -1);
+    sendText(client_fd, "GET / HTTP/1.1\r\nX-Long: ");
+    sendText(client_fd, long_header);
+    readResponse(client_fd, response, sizeof(response));
+    close(client_fd);
+    assert_memory_equal("HTTP/1.1 431 Request Header Fields Too Large\r\n", response, 46);
+}
+
+TEST(idleClient) {
+    (void) state;
+    static Server server;
+
+    ListenAddress first[] = { loopback(1), loopback(2) };
+    Config config = testConfig(first, 2);
+    config.read_timeout = 1;
+    assert_true(serverStart(&server, &config));
+    int removed_fd = atomic_load(&server.current)->listen_fds[1];
+
+    // The only worker sits in read() on a client that never sends anything
+    int client_fd = connectTo(removed_fd);
+    assert_true(client_fd != -1);
+    usleep(100 * 1000);
+
+    ListenAddress second[] = { loopback(1) };
+    config = testConfig(second, 1);
+    config.read_timeout = 1;
+    assert_true(serverReload(&server, &config));
+
+    // The removed listener stays bound while the worker is pinned, then goes once the read times out
+    serverReclaim(&server);
+    assert_non_null(server.retired);
+    assert_true(isOpen(removed_fd));
+    assert_true(waitReclaimed(&server));
+    assert_false(isOpen(removed_fd));
+
+    close(client_fd);
+}
+
+int main(int argc, char *argv[]) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(carryOver),
+        cmocka_unit_test(duplicateCarry),
+        cmocka_unit_test(failedReload),
+        cmocka_unit_test(reclaimGeneration),
+        cmocka_unit_test(partialRequest),
+        cmocka_unit_test(idleClient),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,185 @@
+/**
+ * Worker threads, each accepts on every listening socket of the current snapshot
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "server.h"
+
+static void setTimeout(int conn_fd, int option, int seconds) {
+    struct timeval timeout = { .tv_sec = seconds, .tv_usec = 0 };
+    if (setsockopt(conn_fd, SOL_SOCKET, option, &timeout, sizeof(timeout)) == -1) {
+        perror("setsockopt");
+    }
+}
+
+// The parser accepts bare LF line endings, so both spellings of the blank line count
+static bool hasHeaderEnd(const char *buffer, size_t len) {
+    return memmem(buffer, len, "\n\n", 2) != NULL || memmem(buffer, len, "\n\r\n", 3) != NULL;
+}
+
+// Reads until the header block is complete, the buffer is full, the peer stops sending or the read times out
+static size_t readHeaders(int conn_fd, char *buffer, size_t buffer_len) {
+    size_t len = 0;
+    while (len < buffer_len - 1) {
+        ssize_t num_read = read(conn_fd, buffer + len, buffer_len - 1 - len);
+        if (num_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("read");
+            }
+            break;
+        }
+        if (num_read == 0) {
+            break;
+        }
+        // Only the new bytes and the two before them can complete the blank line
+        size_t from = (len > 2) ? len - 2 : 0;
+        len += num_read;
+        if (hasHeaderEnd(buffer + from, len - from)) {
+            break;
+        }
+    }
+    buffer[len] = '\0';
+    return len;
+}
+
+static void sendError(int conn_fd, const char *status) {
+    char response[256];
+    int len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 %s\r\n"
+                       "Server: webserver-c\r\n"
+                       "Content-Length: 0\r\n"
+                       "Connection: close\r\n\r\n",
+                       status);
+    if (write(conn_fd, response, len) == -1) {
+        perror("write");
+    }
+}
+
+static void handleConnection(int conn_fd, const ConfigSnapshot *snapshot, FileCache *cache, char *buffer, size_t buffer_len) {
+    const Config *config = &snapshot->config;
+    setTimeout(conn_fd, SO_RCVTIMEO, config->read_timeout);
+    setTimeout(conn_fd, SO_SNDTIMEO, config->write_timeout);
+
+    struct sockaddr_storage client_addr;
+    socklen_t client_addr_len = sizeof(client_addr);
+    char client[INET6_ADDRSTRLEN + 8] = "?";
+    if (getpeername(conn_fd, (struct sockaddr *)&client_addr, &client_addr_len) == -1) {
+        perror("client name");
+    } else {
+        formatSockAddress(&client_addr, client, sizeof(client));
+    }
+
+    printf("[%s] - connection accepted\n", client);
+
+    size_t len = readHeaders(conn_fd, buffer, buffer_len);
+    if (len == 0) {
+        return;
+    }
+
+    printf("[%s] - %s\n", client, buffer);
+
+    if (len == buffer_len - 1 && !hasHeaderEnd(buffer, len)) {
+        sendError(conn_fd, "431 Request Header Fields Too Large");
+        return;
+    }
+
+    RequestOrErr request_err = parseRequest(buffer, len);
+    if (request_err.option == OPTION_SOME) {
+        serveFile(conn_fd, snapshot->roots, config->root_count, &request_err.value, cache);
+    } else {
+        sendError(conn_fd, "400 Bad Request");
+    }
+}
+
+void *workerMain(void *arg) {
+    Worker *worker = arg;
+    Server *server = worker->server;
+
+    char *buffer = NULL;
+    size_t buffer_len = 0;
+    size_t cache_len = 0;
+    time_t cache_ttl = -1;
+
+    while (true) {
+        // Quiescent point: from here on only this snapshot is referenced
+        ConfigSnapshot *snapshot = atomic_load(&server->current);
+        atomic_store(&worker->seen, snapshot->generation);
+        const Config *config = &snapshot->config;
+
+        if (worker->index >= config->workers) {
+            break;
+        }
+
+        if (config->file_cache_entries != cache_len || config->file_cache_ttl != cache_ttl) {
+            if (!fileCacheInit(&worker->cache, config->file_cache_entries, config->file_cache_ttl)) {
+                perror("realloc");
+                break;
+            }
+            cache_len = config->file_cache_entries;
+            cache_ttl = config->file_cache_ttl;
+        }
+
+        if (config->buffer_len != buffer_len) {
+            char *resized = realloc(buffer, config->buffer_len);
+            if (resized == NULL) {
+                perror("realloc");
+                break;
+            }
+            buffer = resized;
+            buffer_len = config->buffer_len;
+        }
+
+        struct pollfd fds[CONFIG_MAX_LISTEN];
+        for (size_t i = 0; i < config->listen_count; i++) {
+            fds[i].fd = snapshot->listen_fds[i];
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        int ready = poll(fds, config->listen_count, SERVER_POLL_MS);
+        if (ready == -1) {
+            if (errno != EINTR) {
+                perror("poll");
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < config->listen_count && ready > 0; i++) {
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            ready -= 1;
+
+            int conn_fd = accept(fds[i].fd, NULL, NULL);
+            if (conn_fd == -1) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("accept");
+                }
+                continue;
+            }
+
+            handleConnection(conn_fd, snapshot, &worker->cache, buffer, buffer_len);
+            close(conn_fd);
+        }
+    }
+
+    free(buffer);
+    fileCacheFree(&worker->cache);
+    atomic_store(&worker->seen, SERVER_OFFLINE);
+    atomic_store(&worker->exited, true);
+    return NULL;
+}
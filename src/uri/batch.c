@@ -0,0 +1,237 @@
+/**
+ * Compact Uri representation and batched parsing into a structure of arrays
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "uri.h"
+
+static void setSpan(CompactUri *compact, URI_COMPONENT component, CharSlice slice, const char *source) {
+    UriSpan span = { .offset = (uint32_t)(slice.ptr - source), .len = (uint32_t)slice.len };
+    compact->spans[component] = span;
+    compact->present |= 1 << component;
+}
+
+static void setSpanOpt(CompactUri *compact, URI_COMPONENT component, StrOpt opt, const char *source) {
+    if (opt.option == OPTION_SOME) {
+        setSpan(compact, component, opt.some, source);
+    }
+}
+
+CompactUri compactUri(const Uri *uri, const char *source) {
+    CompactUri compact = { .port = 0, .present = 0 };
+
+    if (uri->scheme.len > 0) {
+        setSpan(&compact, URI_COMPONENT_SCHEME, uri->scheme, source);
+    }
+    setSpanOpt(&compact, URI_COMPONENT_USER, uri->user, source);
+    setSpanOpt(&compact, URI_COMPONENT_PASSWORD, uri->password, source);
+    setSpanOpt(&compact, URI_COMPONENT_HOST, uri->host, source);
+    setSpanOpt(&compact, URI_COMPONENT_PATH, uri->path, source);
+    setSpanOpt(&compact, URI_COMPONENT_QUERY, uri->query, source);
+    setSpanOpt(&compact, URI_COMPONENT_FRAGMENT, uri->fragment, source);
+
+    if (uri->port.option == OPTION_SOME) {
+        compact.port = uri->port.some;
+        compact.present |= URI_PRESENT_PORT;
+    }
+
+    return compact;
+}
+
+static CompactUriOrErr parseCompact(UriOrErr (*parse)(char *, size_t), char *source, size_t len) {
+    if (len > UINT32_MAX) {
+        CompactUriOrErr error = AS_ERROR(URI_ERROR_TOO_LONG);
+        return error;
+    }
+
+    UriOrErr uri_err = parse(source, len);
+    if (uri_err.option != OPTION_SOME) {
+        CompactUriOrErr error = AS_ERROR(uri_err.error);
+        return error;
+    }
+
+    CompactUriOrErr compact_val = AS_VALUE(compactUri(&uri_err.value, source));
+    return compact_val;
+}
+
+CompactUriOrErr parseCompactUri(char *source, size_t len) {
+    return parseCompact(parseUri, source, len);
+}
+
+CompactUriOrErr parseCompactUriNoScheme(char *source, size_t len) {
+    return parseCompact(parseUriNoScheme, source, len);
+}
+
+// Entries [start, end) of the batch belonging to chunk index out of chunks
+static size_t parseChunk(const CharSlice *sources, UriBatch *out, size_t index, size_t chunks, bool no_scheme) {
+    UriOrErr (*parse)(char *, size_t) = no_scheme ? parseUriNoScheme : parseUri;
+    size_t per_chunk = out->count / chunks;
+    size_t extra = out->count % chunks;
+    size_t start = index * per_chunk + (index < extra ? index : extra);
+    size_t end = start + per_chunk + (index < extra ? 1 : 0);
+    size_t parsed = 0;
+
+    for (size_t i = start; i < end; i++) {
+        CompactUriOrErr compact_err = parseCompact(parse, sources[i].ptr, sources[i].len);
+        if (compact_err.option != OPTION_SOME) {
+            out->option[i] = OPTION_ERROR;
+            out->error[i] = compact_err.error;
+            out->present[i] = 0;
+            continue;
+        }
+
+        const CompactUri *compact = &compact_err.value;
+        out->option[i] = OPTION_SOME;
+        out->present[i] = compact->present;
+        out->port[i] = compact->port;
+        for (size_t c = 0; c < URI_COMPONENT_COUNT; c++) {
+            out->offset[c][i] = compact->spans[c].offset;
+            out->len[c][i] = compact->spans[c].len;
+        }
+        parsed += 1;
+    }
+
+    return parsed;
+}
+
+static void *helperMain(void *arg) {
+    UriBatchContext *context = arg;
+
+    pthread_mutex_lock(&context->lock);
+    // Chunk 0 is the caller's, helpers take 1 and up
+    context->next_helper += 1;
+    size_t index = context->next_helper;
+    // Helpers are started before the first round, so none can be missed
+    uint64_t seen_round = 0;
+
+    while (true) {
+        while (!context->stopping && context->round == seen_round) {
+            pthread_cond_wait(&context->start, &context->lock);
+        }
+        if (context->stopping) {
+            break;
+        }
+        seen_round = context->round;
+        if (index >= context->chunks) {
+            continue;
+        }
+
+        const CharSlice *sources = context->sources;
+        UriBatch *out = context->out;
+        size_t chunks = context->chunks;
+        bool no_scheme = context->no_scheme;
+        pthread_mutex_unlock(&context->lock);
+        size_t parsed = parseChunk(sources, out, index, chunks, no_scheme);
+        pthread_mutex_lock(&context->lock);
+
+        context->parsed[index] = parsed;
+        context->pending -= 1;
+        if (context->pending == 0) {
+            pthread_cond_signal(&context->done);
+        }
+    }
+
+    pthread_mutex_unlock(&context->lock);
+    return NULL;
+}
+
+bool uriBatchContextInit(UriBatchContext *context, size_t threads) {
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (size_t)cpus : 1;
+    }
+    if (threads > URI_BATCH_MAX_THREADS) {
+        threads = URI_BATCH_MAX_THREADS;
+    }
+
+    context->min_per_thread = URI_BATCH_MIN_PER_THREAD;
+    context->next_helper = 0;
+    context->round = 0;
+    context->stopping = false;
+    context->chunks = 0;
+    context->pending = 0;
+    context->no_scheme = false;
+
+    if (pthread_mutex_init(&context->lock, NULL) != 0) {
+        return false;
+    }
+    if (pthread_cond_init(&context->start, NULL) != 0) {
+        pthread_mutex_destroy(&context->lock);
+        return false;
+    }
+    if (pthread_cond_init(&context->done, NULL) != 0) {
+        pthread_cond_destroy(&context->start);
+        pthread_mutex_destroy(&context->lock);
+        return false;
+    }
+
+    context->threads = 1;
+    for (size_t t = 1; t < threads; t++) {
+        if (pthread_create(&context->helpers[t], NULL, helperMain, context) != 0) {
+            break;
+        }
+        context->threads += 1;
+    }
+    return true;
+}
+
+void uriBatchContextDestroy(UriBatchContext *context) {
+    pthread_mutex_lock(&context->lock);
+    context->stopping = true;
+    pthread_cond_broadcast(&context->start);
+    pthread_mutex_unlock(&context->lock);
+
+    for (size_t t = 1; t < context->threads; t++) {
+        pthread_join(context->helpers[t], NULL);
+    }
+    pthread_cond_destroy(&context->done);
+    pthread_cond_destroy(&context->start);
+    pthread_mutex_destroy(&context->lock);
+}
+
+static size_t parseBatch(UriBatchContext *context, const CharSlice *sources, UriBatch *out, bool no_scheme) {
+    size_t min_per_thread = (context->min_per_thread > 0) ? context->min_per_thread : 1;
+    size_t chunks = context->threads;
+    if (chunks > out->count / min_per_thread) {
+        chunks = out->count / min_per_thread;
+    }
+    if (chunks <= 1) {
+        return parseChunk(sources, out, 0, 1, no_scheme);
+    }
+
+    pthread_mutex_lock(&context->lock);
+    context->sources = sources;
+    context->out = out;
+    context->chunks = chunks;
+    context->pending = chunks - 1;
+    context->no_scheme = no_scheme;
+    context->round += 1;
+    pthread_cond_broadcast(&context->start);
+    pthread_mutex_unlock(&context->lock);
+
+    size_t parsed = parseChunk(sources, out, 0, chunks, no_scheme);
+
+    pthread_mutex_lock(&context->lock);
+    while (context->pending > 0) {
+        pthread_cond_wait(&context->done, &context->lock);
+    }
+    for (size_t t = 1; t < chunks; t++) {
+        parsed += context->parsed[t];
+    }
+    pthread_mutex_unlock(&context->lock);
+
+    return parsed;
+}
+
+size_t parseUriBatch(UriBatchContext *context, const CharSlice *sources, UriBatch *out) {
+    return parseBatch(context, sources, out, false);
+}
+
+size_t parseUriBatchNoScheme(UriBatchContext *context, const CharSlice *sources, UriBatch *out) {
+    return parseBatch(context, sources, out, true);
+}
@@ -0,0 +1,120 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+
+static void fail(const char *name, const char *what) {
+    fprintf(stderr, "%s: %s\n", name, what);
+    abort();
+}
+
+static void checkSlice(CharSlice slice, const char *source, size_t len, const char *what) {
+    if (slice.ptr < source || slice.len > len || (size_t)(slice.ptr - source) > len - slice.len) {
+        fail("bounds", what);
+    }
+}
+
+static void checkSliceOpt(StrOpt opt, const char *source, size_t len, const char *what) {
+    if (opt.option == OPTION_SOME) {
+        checkSlice(opt.some, source, len, what);
+    } else if (opt.option != OPTION_NONE) {
+        fail("option", what);
+    }
+}
+
+void checkUri(const Uri *uri, const char *source, size_t len) {
+    if (uri->scheme.len > 0) {
+        checkSlice(uri->scheme, source, len, "scheme");
+    }
+    checkSliceOpt(uri->user, source, len, "user");
+    checkSliceOpt(uri->password, source, len, "password");
+    checkSliceOpt(uri->host, source, len, "host");
+    checkSliceOpt(uri->path, source, len, "path");
+    checkSliceOpt(uri->query, source, len, "query");
+    checkSliceOpt(uri->fragment, source, len, "fragment");
+    if (uri->path.option != OPTION_SOME) {
+        fail("path", "missing");
+    }
+}
+
+static bool sameSliceOpt(StrOpt expected, StrOpt actual) {
+    return expected.option == actual.option
+        && (expected.option != OPTION_SOME
+            || (expected.some.ptr == actual.some.ptr && expected.some.len == actual.some.len));
+}
+
+void checkSameUri(const char *name, const Uri *expected, const Uri *actual) {
+    if (!sameSliceOpt(expected->user, actual->user)) {
+        fail(name, "user");
+    }
+    if (!sameSliceOpt(expected->password, actual->password)) {
+        fail(name, "password");
+    }
+    if (!sameSliceOpt(expected->host, actual->host)) {
+        fail(name, "host");
+    }
+    if (!sameSliceOpt(expected->path, actual->path)) {
+        fail(name, "path");
+    }
+    if (!sameSliceOpt(expected->query, actual->query)) {
+        fail(name, "query");
+    }
+    if (!sameSliceOpt(expected->fragment, actual->fragment)) {
+        fail(name, "fragment");
+    }
+    if (expected->port.option != actual->port.option
+        || (expected->port.option == OPTION_SOME && expected->port.some != actual->port.some)) {
+        fail(name, "port");
+    }
+}
+
+static StrOpt spanToStrOpt(const CompactUri *compact, URI_COMPONENT component, const char *source) {
+    if (!(compact->present & (1 << component))) {
+        StrOpt none = AS_NONE();
+        return none;
+    }
+    StrOpt some = AS_SOME({
+        .ptr = (char *)source + compact->spans[component].offset,
+        .len = compact->spans[component].len,
+    });
+    return some;
+}
+
+void checkCompactUri(const char *name, const Uri *expected, const CompactUri *actual, const char *source) {
+    Uri uri = {
+        .scheme = expected->scheme,
+        .user = spanToStrOpt(actual, URI_COMPONENT_USER, source),
+        .password = spanToStrOpt(actual, URI_COMPONENT_PASSWORD, source),
+        .host = spanToStrOpt(actual, URI_COMPONENT_HOST, source),
+        .port = AS_NONE(),
+        .path = spanToStrOpt(actual, URI_COMPONENT_PATH, source),
+        .query = spanToStrOpt(actual, URI_COMPONENT_QUERY, source),
+        .fragment = spanToStrOpt(actual, URI_COMPONENT_FRAGMENT, source),
+    };
+    if (actual->present & URI_PRESENT_PORT) {
+        u16Opt port = AS_SOME(actual->port);
+        uri.port = port;
+    }
+    checkSameUri(name, expected, &uri);
+
+    StrOpt scheme = spanToStrOpt(actual, URI_COMPONENT_SCHEME, source);
+    if ((expected->scheme.len > 0) != (scheme.option == OPTION_SOME)
+        || (scheme.option == OPTION_SOME
+            && (scheme.some.ptr != expected->scheme.ptr || scheme.some.len != expected->scheme.len))) {
+        fail(name, "scheme");
+    }
+}
+
+char *copyInput(const uint8_t *data, size_t size) {
+    // malloc(0) may return NULL, keep one byte so the pointer is always usable
+    char *copy = malloc(size > 0 ? size : 1);
+    if (copy == NULL) {
+        abort();
+    }
+    if (size > 0) {
+        memcpy(copy, data, size);
+    }
+    return copy;
+}
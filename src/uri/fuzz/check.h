@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "../uri.h"
+
+// Every check abort()s on failure so both libFuzzer and AFL record a crash
+
+void checkUri(const Uri * uri, const char * source, size_t len);
+void checkSameUri(const char * name, const Uri * expected, const Uri * actual);
+void checkCompactUri(const char * name, const Uri * expected, const CompactUri * actual, const char * source);
+
+// Fuzzer input is const and not NUL terminated, the parsers want a mutable exact size copy
+char * copyInput(const uint8_t * data, size_t size);
@@ -0,0 +1,113 @@
+/**
+ * Differential harness, parseUri is the reference every other parse path must agree with
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "check.h"
+
+typedef struct DiffCandidate {
+    const char * name;
+    void (*check)(const char * name, char * source, size_t len, const UriOrErr * reference);
+} DiffCandidate;
+
+static void diffNoScheme(const char *name, char *source, size_t len, const UriOrErr *reference) {
+    if (reference->option != OPTION_SOME) {
+        return;
+    }
+    size_t scheme_len = reference->value.scheme.len;
+    UriOrErr uri_err = parseUriNoScheme(source + scheme_len + 1, len - scheme_len - 1);
+    if (uri_err.option != OPTION_SOME) {
+        abort();
+    }
+    checkSameUri(name, &reference->value, &uri_err.value);
+}
+
+static void diffCompact(const char *name, char *source, size_t len, const UriOrErr *reference) {
+    CompactUriOrErr compact_err = parseCompactUri(source, len);
+    if (compact_err.option != reference->option) {
+        abort();
+    }
+    if (compact_err.option == OPTION_SOME) {
+        checkCompactUri(name, &reference->value, &compact_err.value, source);
+    }
+}
+
+static void checkBatch(const char *name, char *source, size_t len, bool no_scheme, const UriOrErr *expected) {
+    CharSlice sources[] = { { .ptr = source, .len = len } };
+    OPTION option;
+    URI_ERROR error;
+    uint16_t present;
+    uint16_t port;
+    uint32_t offset[URI_COMPONENT_COUNT];
+    uint32_t span_len[URI_COMPONENT_COUNT];
+
+    UriBatch out = { .count = 1, .option = &option, .error = &error, .present = &present, .port = &port };
+    for (size_t c = 0; c < URI_COMPONENT_COUNT; c++) {
+        out.offset[c] = &offset[c];
+        out.len[c] = &span_len[c];
+    }
+
+    // A single thread context starts no helpers, so one per input stays cheap
+    static UriBatchContext context;
+    if (!uriBatchContextInit(&context, 1)) {
+        abort();
+    }
+    size_t parsed = no_scheme
+        ? parseUriBatchNoScheme(&context, sources, &out)
+        : parseUriBatch(&context, sources, &out);
+    uriBatchContextDestroy(&context);
+    if (option != expected->option || parsed != (expected->option == OPTION_SOME ? 1 : 0)) {
+        abort();
+    }
+    if (option != OPTION_SOME) {
+        if (error != expected->error) {
+            abort();
+        }
+        return;
+    }
+
+    CompactUri compact = { .port = port, .present = present };
+    for (size_t c = 0; c < URI_COMPONENT_COUNT; c++) {
+        UriSpan span = { .offset = offset[c], .len = span_len[c] };
+        compact.spans[c] = span;
+    }
+    checkCompactUri(name, &expected->value, &compact, source);
+}
+
+static void diffBatch(const char *name, char *source, size_t len, const UriOrErr *reference) {
+    checkBatch(name, source, len, false, reference);
+}
+
+// Checked against parseUriNoScheme on the same input, so origin form targets are covered too
+static void diffBatchNoScheme(const char *name, char *source, size_t len, const UriOrErr *reference) {
+    (void) reference;
+    UriOrErr expected = parseUriNoScheme(source, len);
+    checkBatch(name, source, len, true, &expected);
+}
+
+// Optimized parse paths get an entry here to be checked against the scalar reference
+static const DiffCandidate candidates[] = {
+    { "noScheme", diffNoScheme },
+    { "compact", diffCompact },
+    { "batch", diffBatch },
+    { "batchNoScheme", diffBatchNoScheme },
+};
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *source = copyInput(data, size);
+
+    UriOrErr reference = parseUri(source, size);
+    if (reference.option == OPTION_SOME) {
+        checkUri(&reference.value, source, size);
+    }
+
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        candidates[i].check(candidates[i].name, source, size, &reference);
+    }
+
+    free(source);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "check.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *source = copyInput(data, size);
+
+    UriOrErr uri_err = parseUri(source, size);
+    if (uri_err.option == OPTION_SOME) {
+        checkUri(&uri_err.value, source, size);
+        if (uri_err.value.scheme.ptr != source) {
+            abort();
+        }
+    } else if (uri_err.option != OPTION_ERROR) {
+        abort();
+    }
+
+    free(source);
+    return 0;
+}
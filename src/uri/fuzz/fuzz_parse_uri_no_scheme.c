@@ -0,0 +1,18 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "check.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *source = copyInput(data, size);
+
+    UriOrErr uri_err = parseUriNoScheme(source, size);
+    if (uri_err.option == OPTION_SOME) {
+        checkUri(&uri_err.value, source, size);
+    } else if (uri_err.option != OPTION_ERROR) {
+        abort();
+    }
+
+    free(source);
+    return 0;
+}
@@ -0,0 +1,41 @@
+# Writes every uri literal used by tester.c out as a seed file
+#   cmake -DTESTER=<tester.c> -DCORPUS=<dir> -P seed_corpus.cmake
+# <dir>/parse_uri gets the full uris, <dir>/no_scheme the part after the scheme
+
+file(READ ${TESTER} content)
+# Uris like "http://a/b/c/d;p?q" would otherwise be split up as cmake lists
+string(REPLACE ";" "<semicolon>" content "${content}")
+
+string(REGEX MATCHALL "tryParseUri\\(\"[^\"\n]*\"\\)" calls "${content}")
+string(REGEX MATCHALL "TEST_AUTHORITY_HOST\\(\"[^\"\n]*\"\\)" hosts "${content}")
+string(REGEX MATCHALL "source(\\[\\])? = \"[^\"\n]*\"" sources "${content}")
+string(REGEX MATCHALL "\n +\"[^\"\n]*\"," elements "${content}")
+
+set(uris "")
+foreach(match IN LISTS calls sources elements)
+    string(REGEX REPLACE "^[^\"]*\"([^\"]*)\".*$" "\\1" uri "${match}")
+    list(APPEND uris "${uri}")
+endforeach()
+foreach(match IN LISTS hosts)
+    string(REGEX REPLACE "^[^\"]*\"([^\"]*)\".*$" "scheme://\\1" uri "${match}")
+    list(APPEND uris "${uri}")
+endforeach()
+list(REMOVE_DUPLICATES uris)
+
+file(REMOVE_RECURSE ${CORPUS}/parse_uri ${CORPUS}/no_scheme)
+file(MAKE_DIRECTORY ${CORPUS}/parse_uri ${CORPUS}/no_scheme)
+
+set(index 0)
+foreach(uri IN LISTS uris)
+    string(REPLACE "<semicolon>" ";" uri "${uri}")
+    file(WRITE ${CORPUS}/parse_uri/seed-${index} "${uri}")
+    string(FIND "${uri}" ":" colon)
+    if(colon GREATER_EQUAL 0)
+        math(EXPR colon "${colon} + 1")
+        string(SUBSTRING "${uri}" ${colon} -1 rest)
+        file(WRITE ${CORPUS}/no_scheme/seed-${index} "${rest}")
+    endif()
+    math(EXPR index "${index} + 1")
+endforeach()
+
+file(TOUCH ${CORPUS}/stamp)
@@ -0,0 +1,98 @@
+/**
+ * main() for building the harnesses without libFuzzer
+ *
+ * With no arguments one input is read from stdin (AFL), otherwise every file
+ * and every file inside a directory argument is run once (corpus replay).
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static int runStream(FILE *stream) {
+    size_t capacity = 4096;
+    size_t size = 0;
+    uint8_t *data = malloc(capacity);
+    if (data == NULL) {
+        return -1;
+    }
+
+    size_t num_read;
+    while ((num_read = fread(data + size, 1, capacity - size, stream)) > 0) {
+        size += num_read;
+        if (size == capacity) {
+            capacity *= 2;
+            uint8_t *grown = realloc(data, capacity);
+            if (grown == NULL) {
+                free(data);
+                return -1;
+            }
+            data = grown;
+        }
+    }
+
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return 0;
+}
+
+static int runFile(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    int result = runStream(file);
+    fclose(file);
+    return result;
+}
+
+static int runPath(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == -1) {
+        perror(path);
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return runFile(path);
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        perror(path);
+        return -1;
+    }
+    int result = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char child[4096];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if (runPath(child) == -1) {
+            result = -1;
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        return runStream(stdin) == -1 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    int result = EXIT_SUCCESS;
+    for (int i = 1; i < argc; i++) {
+        if (runPath(argv[i]) == -1) {
+            result = EXIT_FAILURE;
+        }
+    }
+    return result;
+}
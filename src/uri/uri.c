@@ -2,7 +2,8 @@
  * Uri parser, followed zig std uri
  */
 
-#include <assert.h>
+#define _GNU_SOURCE
+
 #include <ctype.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -16,6 +17,8 @@ typedef struct {
     size_t offset;
 } Reader;
 
+typedef AS_ERROR_TYPE(URI_ERROR, uint16_t) PortOrErr;
+
 CharOpt get(Reader *self) {
     if (self->offset >= self->slice.len) {
         CharOpt none = AS_NONE();
@@ -82,7 +85,7 @@ bool peekPrefix(Reader *self, const char * prefix) {
 }
 
 bool isSchemeChar(const char c) {
-    return (isalnum(c) || c == '+' || c == '-' || c == '.');
+    return (isalnum((unsigned char)c) || c == '+' || c == '-' || c == '.');
 }
 
 bool isAuthoritySeparator(const char c) {
@@ -108,15 +111,12 @@ SizeTOpt indexOf(CharSlice slice, char * c) {
 }
 
 SizeTOpt lastIndexOf(CharSlice slice, char * c) {
-    // Does a right index exist?  memrmem?
     size_t len = strlen(c);
 
-    if (slice.len > len) {
-        char * c_ptr = NULL;
-        for (int i = slice.len - len - 1; i >= 0; i--) {
-            c_ptr = memmem(slice.ptr + i, slice.len - i, c, len);
-            if (c_ptr != NULL) {
-                SizeTOpt some = AS_SOME(c_ptr - slice.ptr);
+    if (slice.len >= len) {
+        for (size_t i = slice.len - len + 1; i > 0; i--) {
+            if (memcmp(slice.ptr + i - 1, c, len) == 0) {
+                SizeTOpt some = AS_SOME(i - 1);
                 return some;
             }
         }
@@ -126,6 +126,24 @@ SizeTOpt lastIndexOf(CharSlice slice, char * c) {
     return none;
 }
 
+// Empty is port 0 as before, anything but digits or a value past 65535 is an error
+PortOrErr parsePort(CharSlice slice) {
+    uint32_t port = 0;
+    for (size_t i = 0; i < slice.len; i++) {
+        if (!isdigit((unsigned char)slice.ptr[i])) {
+            PortOrErr error = AS_ERROR(URI_ERROR_BAD_FORMAT);
+            return error;
+        }
+        port = port * 10 + (slice.ptr[i] - '0');
+        if (port > UINT16_MAX) {
+            PortOrErr error = AS_ERROR(URI_ERROR_BAD_FORMAT);
+            return error;
+        }
+    }
+    PortOrErr port_val = AS_VALUE((uint16_t)port);
+    return port_val;
+}
+
 UriOrErr parseUri(char *source, size_t len) {
     Reader reader = { .slice = { .ptr = source, .len = len }, .offset = 0 };
 
@@ -172,8 +190,8 @@ UriOrErr parseUriNoScheme(char *source, size_t len) {
     Reader reader = { .slice = { .ptr = source, .len = len }, .offset = 0 };
 
     if (peekPrefix(&reader, "//")) {
-        assert(get(&reader).some == '/');
-        assert(get(&reader).some == '/');
+        get(&reader);
+        get(&reader);
 
         CharSlice authority = readUntil(&reader, isAuthoritySeparator);
         if (authority.len == 0) {
@@ -208,7 +226,7 @@ UriOrErr parseUriNoScheme(char *source, size_t len) {
 
         size_t end_of_host = authority.len;
 
-        if (authority.ptr[start_of_host] == '[') {
+        if (start_of_host < authority.len && authority.ptr[start_of_host] == '[') {
             SizeTOpt end_opt = lastIndexOf(authority, "]");
             if (end_opt.option == OPTION_NONE) {
                 UriOrErr error = AS_ERROR(URI_ERROR_BAD_FORMAT);
@@ -221,10 +239,15 @@ UriOrErr parseUriNoScheme(char *source, size_t len) {
                 const size_t index = index_opt.some;
                 if (index >= end_of_host) {
                     end_of_host = (index < end_of_host ? index : end_of_host);
-                    char buffer[authority.len - index];
-                    strncpy(buffer, authority.ptr + index + 1, authority.len - index - 1);
-                    buffer[authority.len - index - 1] = '\0';
-                    u16Opt port = AS_SOME(atoi(buffer));
+                    PortOrErr port_err = parsePort((CharSlice){
+                        .ptr = authority.ptr + index + 1,
+                        .len = authority.len - index - 1,
+                    });
+                    if (port_err.option != OPTION_SOME) {
+                        UriOrErr error = AS_ERROR(port_err.error);
+                        return error;
+                    }
+                    u16Opt port = AS_SOME(port_err.value);
                     uri.port = port;
                 }
             }
@@ -234,15 +257,26 @@ UriOrErr parseUriNoScheme(char *source, size_t len) {
                 const size_t index = idx_opt.some;
                 if (index >= start_of_host) {
                     end_of_host = (index < end_of_host ? index : end_of_host);
-                    char buffer[authority.len - index];
-                    strncpy(buffer, authority.ptr + index + 1, authority.len - index - 1);
-                    buffer[authority.len - index - 1] = '\0';
-                    u16Opt port = AS_SOME(atoi(buffer));
+                    PortOrErr port_err = parsePort((CharSlice){
+                        .ptr = authority.ptr + index + 1,
+                        .len = authority.len - index - 1,
+                    });
+                    if (port_err.option != OPTION_SOME) {
+                        UriOrErr error = AS_ERROR(port_err.error);
+                        return error;
+                    }
+                    u16Opt port = AS_SOME(port_err.value);
                     uri.port = port;
                 }
             }
         }
 
+        // "]" or ":" inside the user info can land before the host
+        if (end_of_host < start_of_host) {
+            UriOrErr error = AS_ERROR(URI_ERROR_BAD_FORMAT);
+            return error;
+        }
+
         StrOpt host = AS_SOME({
             .ptr = authority.ptr + start_of_host,
             .len = end_of_host - start_of_host
@@ -255,14 +289,14 @@ UriOrErr parseUriNoScheme(char *source, size_t len) {
 
     CharOpt peek_opt = peek(&reader);
     if (peek_opt.option == OPTION_SOME && peek_opt.some == '?') {
-        assert(get(&reader).some == '?');
+        get(&reader);
         StrOpt query = AS_SOME(readUntil(&reader, isQuerySeparator));
         uri.query = query;
     }
 
     peek_opt = peek(&reader);
     if (peek_opt.option == OPTION_SOME && peek_opt.some == '#') {
-        assert(get(&reader).some == '#');
+        get(&reader);
         StrOpt fragment = AS_SOME(readUntilEof(&reader));
         uri.fragment = fragment;
     }